@@ -0,0 +1,278 @@
+#ifndef ABORT_POLICY_SOLVER_H
+#define ABORT_POLICY_SOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "Glicko.h"
+#include "GlickoBatch.h"
+#include "ParallelFor.h"
+#include "SessionSimulator.h"
+
+// Solved accept/abort policy for one session, as a bit table indexed by
+// (pairings left, abort state, player rating, opponent RD, opponent rating).
+// Every query snaps to the nearest grid point, so it is a handful of integer
+// operations and one bit test. Built by AbortPolicySolver.
+class AbortPolicy {
+public:
+    // True if the solved policy aborts the pairing. abortsUsed counts the
+    // session's aborts so far; abortsExhausted is set once one was refused.
+    bool abort(int pairingsLeft, int abortsUsed, bool abortsExhausted, double rating, double oppRating,
+               double oppRD) const {
+        size_t i = index(pairingsLeft, abortsUsed, abortsExhausted, rating, oppRating, oppRD);
+        return (bits[i >> 6] >> (i & 63)) & 1;
+    }
+
+    bool operator()(const SessionPairing& p, const AbortBelief& belief) const {
+        return abort(p.pairingsLeft, belief.abortsRecorded(), p.abortsExhausted, p.playerRating, p.oppRating,
+                     p.oppRD);
+    }
+
+    // Expected net rating change from here to the end of the session when
+    // following the policy.
+    double value(int pairingsLeft, int abortsUsed, bool abortsExhausted, double rating) const {
+        int h = std::min(std::max(pairingsLeft, 0), horizon);
+        int i = nearest(rating, x0, xStep, nx);
+        return values[(static_cast<size_t>(h) * states + state(abortsUsed, abortsExhausted)) * nx + i] -
+               (x0 + i * xStep - startRating);
+    }
+
+    int pairings() const { return horizon; }
+    size_t bytes() const { return bits.size() * sizeof(uint64_t); }
+
+private:
+    friend class AbortPolicySolver;
+
+    double startRating;
+    int horizon;
+    int states; // aborts used 0..maxAborts, then "exhausted"
+    int nx, nrd, no;
+    double x0, xStep;   // player rating grid
+    double rd0, rdStep; // opponent RD grid
+    double o0, oStep;   // opponent rating offset grid
+    std::vector<uint64_t> bits;  // [h - 1][state][x][rd][o]
+    std::vector<double> values;  // [h][state][x], final rating - startRating
+
+    static int nearest(double v, double v0, double step, int n) {
+        if (n <= 1 || step <= 0) return 0;
+        long k = std::lround((v - v0) / step);
+        return static_cast<int>(std::min<long>(std::max<long>(k, 0), n - 1));
+    }
+
+    int state(int abortsUsed, bool abortsExhausted) const {
+        if (abortsExhausted) return states - 1;
+        return std::min(std::max(abortsUsed, 0), states - 2);
+    }
+
+    size_t index(int pairingsLeft, int abortsUsed, bool abortsExhausted, double rating, double oppRating,
+                 double oppRD) const {
+        int h = std::min(std::max(pairingsLeft, 1), horizon);
+        size_t i = static_cast<size_t>(h - 1) * states + state(abortsUsed, abortsExhausted);
+        i = i * nx + nearest(rating, x0, xStep, nx);
+        i = i * nrd + nearest(std::max(oppRD, kChessComRDFloor), rd0, rdStep, nrd);
+        return i * no + nearest(oppRating - rating, o0, oStep, no);
+    }
+};
+
+// Finite-horizon MDP for the abort decision, solved by backward value
+// iteration. It uses the same session model as SessionSimulator: opponent
+// pool, true strength, draw rate and an abort allowance uniform over
+// [minAborts, maxAborts] where an abort past the allowance is a forfeit loss.
+//
+// The state is (pairings left, aborts used, rating on a grid around the
+// start rating). With a aborts accepted, the next one is accepted with
+// probability P(allowance > a) / P(allowance >= a); a refused abort moves to
+// the "exhausted" state, where playing is always at least as good. The player
+// RD is held at the clamped starting RD, and ratings that leave the grid are
+// held at its edge. The objective is the expected final rating.
+//
+// Outcomes for every (rating, opponent) cell are computed once with
+// GlickoBatch and stored as interpolation weights, since they do not depend on
+// the pairings left or the abort state. Each backward step is then split into
+// (state, rating block) tiles run in parallel; a tile streams its contiguous
+// slice of the transition table against one previous value row.
+class AbortPolicySolver {
+public:
+    struct Config {
+        SessionSimulator::Config session;
+        double ratingRadius; // player rating grid: start +- ratingRadius
+        double ratingStep;
+        double oppSigmas;    // opponent offsets out to mean +- oppSigmas * spread
+        double oppStep;
+        int rdBins;          // opponent RD buckets over [oppRDMin, oppRDMax]
+        int blockRows;       // rating rows per tile
+
+        Config()
+            : ratingRadius(300), ratingStep(10), oppSigmas(3), oppStep(20), rdBins(4), blockRows(16) {}
+    };
+
+    static AbortPolicy solve(const Config& config = Config()) {
+        const SessionSimulator::Config& s = config.session;
+        if (s.pairingsPerSession <= 0 || s.minAborts > s.maxAborts || s.minAborts < 0 ||
+            config.ratingStep <= 0 || config.ratingRadius < config.ratingStep || config.oppStep <= 0 ||
+            config.rdBins <= 0) {
+            throw std::invalid_argument("AbortPolicySolver: invalid configuration");
+        }
+
+        AbortPolicy policy;
+        policy.startRating = s.playerRating;
+        policy.horizon = s.pairingsPerSession;
+        policy.states = s.maxAborts + 2;
+        const int half = static_cast<int>(std::lround(config.ratingRadius / config.ratingStep));
+        policy.nx = 2 * half + 1;
+        policy.xStep = config.ratingStep;
+        policy.x0 = s.playerRating - half * config.ratingStep;
+        const int oHalf = s.oppSpread > 0
+                              ? static_cast<int>(std::lround(config.oppSigmas * s.oppSpread / config.oppStep))
+                              : 0;
+        policy.no = 2 * oHalf + 1;
+        policy.oStep = config.oppStep;
+        policy.o0 = s.oppMeanOffset - oHalf * config.oppStep;
+        policy.nrd = config.rdBins;
+        policy.rdStep = (s.oppRDMax - s.oppRDMin) / config.rdBins;
+        policy.rd0 = s.oppRDMin + policy.rdStep / 2;
+
+        std::vector<Transition> trans;
+        std::vector<double> weight;
+        buildTransitions(config, policy, trans, weight);
+
+        const int S = policy.states, nx = policy.nx;
+        const size_t perRow = static_cast<size_t>(policy.nrd) * policy.no;
+        const size_t bitsPerStep = static_cast<size_t>(S) * nx * perRow;
+        policy.bits.assign((bitsPerStep * policy.horizon + 63) / 64, 0);
+        policy.values.assign(static_cast<size_t>(policy.horizon + 1) * S * nx, 0.0);
+        for (int st = 0; st < S; ++st) {
+            for (int i = 0; i < nx; ++i) {
+                policy.values[static_cast<size_t>(st) * nx + i] = policy.x0 + i * policy.xStep - s.playerRating;
+            }
+        }
+
+        // Chance that abort number a + 1 is accepted given a were.
+        std::vector<double> accept(S, 0.0);
+        const double allowances = s.maxAborts - s.minAborts + 1;
+        for (int a = 0; a <= s.maxAborts; ++a) {
+            double atLeast = (s.maxAborts - std::max(a, s.minAborts) + 1) / allowances;
+            double more = a + 1 <= s.maxAborts ? (s.maxAborts - std::max(a + 1, s.minAborts) + 1) / allowances : 0;
+            accept[a] = atLeast > 0 ? more / atLeast : 0;
+        }
+
+        const int block = std::max(1, config.blockRows);
+        const int blocks = (nx + block - 1) / block;
+        for (int h = 1; h <= policy.horizon; ++h) {
+            const double* prev = &policy.values[static_cast<size_t>(h - 1) * S * nx];
+            double* cur = &policy.values[static_cast<size_t>(h) * S * nx];
+            const size_t bitBase = static_cast<size_t>(h - 1) * bitsPerStep;
+            // Tiles write whole 64-bit words only if no word straddles two
+            // tiles, so collect decisions per tile and pack them afterwards.
+            std::vector<uint8_t> decide(bitsPerStep);
+
+            parallelFor(0, static_cast<size_t>(S) * blocks, 1, [&](size_t lo, size_t hi, unsigned) {
+                for (size_t tile = lo; tile < hi; ++tile) {
+                    const int st = static_cast<int>(tile / blocks);
+                    const int xBegin = static_cast<int>(tile % blocks) * block;
+                    const int xEnd = std::min(nx, xBegin + block);
+                    const double* row = prev + static_cast<size_t>(st) * nx;
+                    const double* rowAccepted = st + 1 < S - 1 ? prev + static_cast<size_t>(st + 1) * nx : row;
+                    const double* rowExhausted = prev + static_cast<size_t>(S - 1) * nx;
+                    const double pAccept = st == S - 1 ? 0.0 : accept[st];
+
+                    for (int i = xBegin; i < xEnd; ++i) {
+                        const Transition* t = &trans[static_cast<size_t>(i) * perRow];
+                        uint8_t* d = &decide[(static_cast<size_t>(st) * nx + i) * perRow];
+                        const double stay = rowAccepted[i];
+                        double total = 0;
+                        for (size_t k = 0; k < perRow; ++k) {
+                            double play = t[k].pWin * interp(row, t[k].win) + t[k].pDraw * interp(row, t[k].draw) +
+                                          t[k].pLose * interp(row, t[k].lose);
+                            double abort = pAccept * stay + (1 - pAccept) * interp(rowExhausted, t[k].lose);
+                            d[k] = abort > play;
+                            total += weight[k] * std::max(play, abort);
+                        }
+                        cur[static_cast<size_t>(st) * nx + i] = total;
+                    }
+                }
+            }, s.threads);
+
+            for (size_t k = 0; k < bitsPerStep; ++k) {
+                if (decide[k]) {
+                    size_t b = bitBase + k;
+                    policy.bits[b >> 6] |= uint64_t(1) << (b & 63);
+                }
+            }
+        }
+        return policy;
+    }
+
+private:
+    // Where one outcome lands on the rating grid.
+    struct Landing {
+        int j;    // lower grid index
+        double w; // weight of j + 1
+    };
+
+    struct Transition {
+        double pWin, pDraw, pLose;
+        Landing win, draw, lose;
+    };
+
+    static double interp(const double* row, const Landing& l) {
+        return row[l.j] + l.w * (row[l.j + 1] - row[l.j]);
+    }
+
+    static Landing land(double rating, const AbortPolicy& policy) {
+        double u = (rating - policy.x0) / policy.xStep;
+        u = std::min(std::max(u, 0.0), static_cast<double>(policy.nx - 1));
+        Landing l;
+        l.j = std::min(static_cast<int>(u), policy.nx - 2);
+        l.w = u - l.j;
+        return l;
+    }
+
+    // Fills trans[x][rd][o] and the pool weight of every (rd, o) column.
+    static void buildTransitions(const Config& config, const AbortPolicy& policy, std::vector<Transition>& trans,
+                                 std::vector<double>& weight) {
+        const SessionSimulator::Config& s = config.session;
+        const size_t perRow = static_cast<size_t>(policy.nrd) * policy.no;
+        const size_t n = perRow * policy.nx;
+
+        weight.assign(perRow, 0.0);
+        double sum = 0;
+        for (int o = 0; o < policy.no; ++o) {
+            double z = s.oppSpread > 0 ? (policy.o0 + o * policy.oStep - s.oppMeanOffset) / s.oppSpread : 0;
+            double w = std::exp(-0.5 * z * z);
+            for (int rd = 0; rd < policy.nrd; ++rd) weight[static_cast<size_t>(rd) * policy.no + o] = w;
+            sum += w * policy.nrd;
+        }
+        for (double& w : weight) w /= sum;
+
+        const double RD = std::max(s.playerRD, kChessComRDFloor);
+        std::vector<double> r(n), rd(n, RD), r_j(n), RD_j(n), win(n), lose(n), draw(n), newRD(n);
+        for (int i = 0; i < policy.nx; ++i) {
+            for (int b = 0; b < policy.nrd; ++b) {
+                for (int o = 0; o < policy.no; ++o) {
+                    size_t k = (static_cast<size_t>(i) * policy.nrd + b) * policy.no + o;
+                    r[k] = policy.x0 + i * policy.xStep;
+                    r_j[k] = r[k] + policy.o0 + o * policy.oStep;
+                    RD_j[k] = std::max(policy.rd0 + b * policy.rdStep, kChessComRDFloor);
+                }
+            }
+        }
+        GlickoBatch::calculateOutcomes(r.data(), rd.data(), r_j.data(), RD_j.data(), win.data(), lose.data(),
+                                       draw.data(), newRD.data(), n);
+
+        const double trueRating = std::isnan(s.trueRating) ? s.playerRating : s.trueRating;
+        trans.resize(n);
+        for (size_t k = 0; k < n; ++k) {
+            Transition& t = trans[k];
+            SessionSimulator::resultProbabilities(trueRating, r_j[k], s.drawRate, t.pWin, t.pDraw, t.pLose);
+            t.win = land(win[k], policy);
+            t.draw = land(draw[k], policy);
+            t.lose = land(lose[k], policy);
+        }
+    }
+};
+
+#endif // ABORT_POLICY_SOLVER_H
@@ -0,0 +1,465 @@
+#ifndef ARCHIVE_INGESTER_H
+#define ARCHIVE_INGESTER_H
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "GameStore.h"
+#include "ParallelFor.h"
+#include "RequestScheduler.h"
+#include "StatsExtractor.h"
+
+// Loads players' monthly game archives (/games/archives, then one
+// /games/YYYY/MM per month) into a GameStore.
+//
+// Months are fetched and parsed in parallel, a window of them at a time,
+// while the previous window is appended to the store on another thread.
+// Each month is read with a SAX handler straight into ArchiveGame records,
+// so no month's json tree is ever built; only the response text and the
+// compact records of the window in flight are held in memory. Windows are
+// appended in order, so a player's rows come out in time order and the
+// result does not depend on the thread count.
+//
+// Only rated standard games and daily chess960 are kept, matching the
+// PlayerStats modes; other variants and unrated games are counted as
+// skipped.
+//
+// Each player's progress is kept as a GameStore::SyncMark (newest month read,
+// newest game stored and how many games ended in that second), committed
+// with the rows. Games up to the mark are never appended twice, a game that
+// ends in the same second as the mark is not lost, and sync() uses the mark
+// to fetch only the months that can hold new games.
+class ArchiveIngester {
+public:
+    // Fetches `url` into `body`; false if it is unavailable.
+    typedef std::function<bool(const std::string& url, std::string& body)> Source;
+
+    struct Config {
+        unsigned threads; // 0 = all cores
+        size_t window;    // months parsed per batch; 0 = 4 per thread
+        int64_t now;      // unix seconds deciding the current month for sync(); 0 = clock
+
+        Config() : threads(0), window(0), now(0) {}
+    };
+
+    struct Report {
+        size_t players;
+        size_t months;
+        size_t games;   // rows appended
+        size_t skipped; // unrated, other variants, or not the owner's game
+        size_t failed;  // archive lists or months that could not be read
+        size_t requests;
+        double seconds;
+    };
+
+    ArchiveIngester(GameStore& store, Source source, const Config& config = Config())
+        : store(store), source(source), config(config) {}
+
+    // Reads every month in each player's archive list. Games already in the
+    // store (up to the player's sync mark) are not appended again.
+    Report ingest(const std::vector<std::string>& usernames) { return load(usernames, false); }
+
+    // Incremental refresh: for a player with a sync mark, only the marked
+    // month and the ones after it up to the current month are fetched,
+    // without the archive list, so a player with nothing new costs one
+    // request. Players without a mark are ingested in full.
+    Report sync(const std::vector<std::string>& usernames) { return load(usernames, true); }
+
+    // Month URLs listed by an /archives response, oldest first.
+    static bool monthUrls(const std::string& body, std::vector<std::string>& out) {
+        nlohmann::json j = nlohmann::json::parse(body, nullptr, false);
+        if (!j.is_object() || !j.contains("archives") || !j["archives"].is_array()) return false;
+        out.clear();
+        for (const nlohmann::json& url : j["archives"]) {
+            if (url.is_string()) out.push_back(url.get<std::string>());
+        }
+        std::sort(out.begin(), out.end());
+        return true;
+    }
+
+    // Parses one monthly archive into `owner`'s games, in the archive's order
+    // (by end time). Returns false on malformed json.
+    static bool parseMonth(const std::string& body, const std::string& owner, std::vector<ArchiveGame>& out,
+                           size_t& skipped) {
+        MonthHandler handler(lower(owner), out, skipped);
+        return nlohmann::json::sax_parse(body, &handler);
+    }
+
+    static std::string archivesUrl(const std::string& username) {
+        return "https://api.chess.com/pub/player/" + lower(username) + "/games/archives";
+    }
+
+    // `month` is "YYYY/MM".
+    static std::string monthUrl(const std::string& username, const std::string& month) {
+        return "https://api.chess.com/pub/player/" + lower(username) + "/games/" + month;
+    }
+
+    // Months from `first` through the one containing `now`, as "YYYY/MM".
+    static std::vector<std::string> monthsSince(const std::string& first, int64_t now) {
+        std::vector<std::string> out;
+        int year = 0, month = 0;
+        if (std::sscanf(first.c_str(), "%d/%d", &year, &month) != 2 || month < 1 || month > 12) return out;
+        std::time_t t = static_cast<std::time_t>(now);
+        std::tm utc;
+        gmtime_r(&t, &utc);
+        const int lastYear = utc.tm_year + 1900, lastMonth = utc.tm_mon + 1;
+        while (year < lastYear || (year == lastYear && month <= lastMonth)) {
+            char buf[16];
+            std::snprintf(buf, sizeof(buf), "%04d/%02d", year, month);
+            out.push_back(buf);
+            if (++month > 12) {
+                month = 1;
+                ++year;
+            }
+        }
+        return out;
+    }
+
+    // Recorded responses in a directory, for running offline:
+    //   <dir>/<username>/archives.json  for .../player/<username>/games/archives
+    //   <dir>/<username>/YYYY-MM.json   for .../player/<username>/games/YYYY/MM
+    static Source fixtures(const std::string& dir) {
+        return [dir](const std::string& url, std::string& body) {
+            const std::string marker = "/pub/player/";
+            size_t at = url.find(marker);
+            if (at == std::string::npos) return false;
+            std::string rest = url.substr(at + marker.size());
+            size_t slash = rest.find('/');
+            if (slash == std::string::npos) return false;
+            std::string user = lower(rest.substr(0, slash));
+            std::string path = rest.substr(slash + 1);
+            std::string file;
+            if (path == "games/archives") {
+                file = "archives.json";
+            } else if (path.size() == 13 && path.compare(0, 6, "games/") == 0 && path[10] == '/') {
+                file = path.substr(6, 4) + "-" + path.substr(11, 2) + ".json";
+            } else {
+                return false;
+            }
+            std::ifstream in(dir + "/" + user + "/" + file, std::ios::binary);
+            if (!in) return false;
+            std::ostringstream ss;
+            ss << in.rdbuf();
+            body = ss.str();
+            return true;
+        };
+    }
+
+    // The live API, at background priority so interactive lookups go first.
+    static Source http() {
+        return [](const std::string& url, std::string& body) {
+            try {
+                CurlPool::Response response = RequestScheduler::instance().get(url, RequestScheduler::Background);
+                if (response.status != 200) return false;
+                body.swap(response.body);
+                return true;
+            } catch (const std::exception& ex) {
+                std::cerr << "Error: " << ex.what() << std::endl;
+                return false;
+            }
+        };
+    }
+
+private:
+    struct Task {
+        size_t player;          // index into the usernames
+        std::string url;
+        int64_t after;          // keep games that ended after this second,
+        uint32_t storedAtAfter; // and those in it past the first this many
+    };
+
+    GameStore& store;
+    Source source;
+    Config config;
+
+    static std::string lower(std::string s) {
+        for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    Report load(const std::vector<std::string>& usernames, bool incremental) {
+        auto start = std::chrono::steady_clock::now();
+        Report report = Report();
+        report.players = usernames.size();
+        const unsigned threads = workerCount(config.threads);
+        const int64_t now = config.now != 0 ? config.now : static_cast<int64_t>(std::time(nullptr));
+
+        std::vector<GameStore::SyncMark> marks(usernames.size());
+        std::vector<char> marked(usernames.size(), 0);
+        for (size_t i = 0; i < usernames.size(); ++i) {
+            long id = store.find(usernames[i]);
+            marked[i] = id >= 0 && store.syncMark(static_cast<uint32_t>(id), marks[i]);
+        }
+
+        // Archive lists, one request per player that needs one.
+        std::vector<std::vector<std::string>> months(usernames.size());
+        std::vector<char> listed(usernames.size(), 0);
+        parallelFor(0, usernames.size(), 1, [&](size_t lo, size_t hi, unsigned) {
+            for (size_t i = lo; i < hi; ++i) {
+                if (incremental && marked[i]) {
+                    listed[i] = 1;
+                    for (const std::string& m : monthsSince(marks[i].month, now)) {
+                        months[i].push_back(monthUrl(usernames[i], m));
+                    }
+                    continue;
+                }
+                std::string body;
+                listed[i] = source(archivesUrl(usernames[i]), body) && monthUrls(body, months[i]);
+            }
+        }, threads);
+
+        std::vector<Task> tasks;
+        for (size_t i = 0; i < usernames.size(); ++i) {
+            if (!(incremental && marked[i])) ++report.requests;
+            if (!listed[i]) {
+                std::cerr << "Error: ArchiveIngester: no archive list for " << usernames[i] << std::endl;
+                ++report.failed;
+                continue;
+            }
+            for (const std::string& url : months[i]) {
+                // Months before the mark hold nothing new.
+                if (marked[i] && url.compare(url.size() - 7, 7, marks[i].month) < 0) continue;
+                tasks.push_back(Task{i, url, marked[i] ? marks[i].lastEndTime : INT64_MIN,
+                                     marked[i] ? marks[i].atLastEndTime : 0});
+            }
+        }
+        report.months = tasks.size();
+        report.requests += tasks.size();
+        run(usernames, tasks, marks, report, threads);
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+    void run(const std::vector<std::string>& usernames, const std::vector<Task>& tasks,
+             std::vector<GameStore::SyncMark>& marks, Report& report, unsigned threads) {
+        const size_t window = config.window > 0 ? config.window : 4 * static_cast<size_t>(threads);
+        // A player whose month failed gets nothing newer this run: storing
+        // later games would move the mark past the missing ones.
+        std::vector<char> stopped(usernames.size(), 0);
+        std::future<void> writing;
+        for (size_t begin = 0; begin < tasks.size(); begin += window) {
+            const size_t end = std::min(tasks.size(), begin + window);
+            std::vector<std::vector<ArchiveGame>> games(end - begin);
+            std::vector<size_t> skipped(end - begin, 0);
+            std::vector<char> ok(end - begin, 0);
+            parallelFor(begin, end, 1, [&](size_t lo, size_t hi, unsigned) {
+                std::string body;
+                for (size_t t = lo; t < hi; ++t) {
+                    body.clear();
+                    ok[t - begin] = source(tasks[t].url, body) &&
+                                    parseMonth(body, usernames[tasks[t].player], games[t - begin], skipped[t - begin]);
+                }
+            }, threads);
+
+            if (writing.valid()) writing.get();
+            std::vector<std::pair<size_t, GameStore::SyncMark>> updates;
+            for (size_t t = begin; t < end; ++t) {
+                const Task& task = tasks[t];
+                std::vector<ArchiveGame>& month = games[t - begin];
+                report.skipped += skipped[t - begin];
+                if (stopped[task.player]) {
+                    month.clear();
+                    continue;
+                }
+                if (!ok[t - begin]) {
+                    std::cerr << "Error: ArchiveIngester: cannot read " << task.url << std::endl;
+                    ++report.failed;
+                    stopped[task.player] = 1;
+                    month.clear(); // a partly parsed month would leave a gap later
+                    continue;
+                }
+                // A month lists its games in end-time order, so the stored
+                // games at the mark's second are the first ones there.
+                uint32_t atMark = 0;
+                size_t kept = 0;
+                for (const ArchiveGame& g : month) {
+                    if (g.endTime < task.after) continue;
+                    if (g.endTime == task.after && atMark++ < task.storedAtAfter) continue;
+                    month[kept++] = g;
+                }
+                month.resize(kept);
+                report.games += month.size();
+                GameStore::SyncMark& mark = marks[task.player];
+                mark.month = task.url.substr(task.url.size() - 7);
+                for (const ArchiveGame& g : month) {
+                    if (g.endTime > mark.lastEndTime) {
+                        mark.lastEndTime = g.endTime;
+                        mark.atLastEndTime = 1;
+                    } else if (g.endTime == mark.lastEndTime) {
+                        ++mark.atLastEndTime;
+                    }
+                }
+                updates.emplace_back(task.player, mark);
+            }
+            writing = std::async(std::launch::async, [this, &usernames, &tasks, begin](
+                                                         std::vector<std::vector<ArchiveGame>> batch,
+                                                         std::vector<std::pair<size_t, GameStore::SyncMark>> updates) {
+                for (size_t t = 0; t < batch.size(); ++t) store.append(usernames[tasks[begin + t].player], batch[t]);
+                for (const auto& u : updates) store.setSyncMark(store.intern(usernames[u.first]), u.second);
+                store.commit();
+            }, std::move(games), std::move(updates));
+        }
+        if (writing.valid()) writing.get();
+    }
+
+    // SAX handler for a monthly archive: {"games": [{...}, ...]}. Keeps the
+    // few fields of the current game and turns it into an ArchiveGame at
+    // its closing brace.
+    class MonthHandler {
+    public:
+        MonthHandler(const std::string& owner, std::vector<ArchiveGame>& out, size_t& skipped)
+            : owner(owner), out(out), skipped(skipped), depth(0), inGames(false), gameKey(Other), sideKey(Other) {}
+
+        bool null() { return true; }
+        bool boolean(bool v) {
+            if (depth == 3 && gameKey == Rated) game.rated = v;
+            return true;
+        }
+        bool number_integer(nlohmann::json::number_integer_t v) { return number(static_cast<int64_t>(v)); }
+        bool number_unsigned(nlohmann::json::number_unsigned_t v) { return number(static_cast<int64_t>(v)); }
+        bool number_float(nlohmann::json::number_float_t v, const std::string&) {
+            return number(static_cast<int64_t>(v));
+        }
+        bool binary(nlohmann::json::binary_t&) { return true; }
+
+        bool string(std::string& v) {
+            if (!inGames) return true;
+            if (depth == 3) {
+                if (gameKey == TimeClass) game.timeClass.swap(v);
+                if (gameKey == Rules) game.rules.swap(v);
+            } else if (depth == 4 && side()) {
+                if (sideKey == Username) side()->username = lower(v);
+                if (sideKey == SideResult) side()->result.swap(v);
+            }
+            return true;
+        }
+
+        bool start_object(std::size_t) {
+            ++depth;
+            if (inGames && depth == 3) game = Game();
+            return true;
+        }
+        bool start_array(std::size_t) {
+            ++depth;
+            return true;
+        }
+        bool end_object() {
+            if (inGames && depth == 3) finish();
+            if (depth == 4) gameKey = Other;
+            --depth;
+            return true;
+        }
+        bool end_array() {
+            if (depth == 2) inGames = false;
+            --depth;
+            return true;
+        }
+
+        bool key(std::string& k) {
+            if (depth == 1) {
+                inGames = k == "games";
+            } else if (depth == 3) {
+                gameKey = k == "end_time" ? EndTime : k == "time_class" ? TimeClass : k == "rules" ? Rules
+                        : k == "rated" ? Rated : k == "white" ? White : k == "black" ? Black : Other;
+            } else if (depth == 4) {
+                sideKey = k == "rating" ? Rating : k == "result" ? SideResult : k == "username" ? Username : Other;
+            }
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) { return false; }
+
+    private:
+        enum Key { Other, EndTime, TimeClass, Rules, Rated, White, Black, Rating, SideResult, Username };
+
+        struct Side {
+            std::string username;
+            std::string result;
+            int rating = -1;
+        };
+
+        struct Game {
+            int64_t endTime = 0;
+            std::string timeClass;
+            std::string rules;
+            bool rated = true;
+            Side sides[2]; // white, black
+        };
+
+        std::string owner;
+        std::vector<ArchiveGame>& out;
+        size_t& skipped;
+        int depth;
+        bool inGames;
+        Key gameKey, sideKey;
+        Game game;
+
+        Side* side() {
+            return gameKey == White ? &game.sides[0] : gameKey == Black ? &game.sides[1] : nullptr;
+        }
+
+        bool number(int64_t v) {
+            if (!inGames) return true;
+            if (depth == 3 && gameKey == EndTime) game.endTime = v;
+            if (depth == 4 && sideKey == Rating && side()) side()->rating = static_cast<int>(v);
+            return true;
+        }
+
+        static bool isDraw(const std::string& result) {
+            return result == "agreed" || result == "repetition" || result == "stalemate" ||
+                   result == "insufficient" || result == "50move" || result == "timevsinsufficient";
+        }
+
+        static int mode(const std::string& timeClass, const std::string& rules) {
+            if (rules == "chess") {
+                if (timeClass == "bullet") return PlayerStats::Bullet;
+                if (timeClass == "blitz") return PlayerStats::Blitz;
+                if (timeClass == "rapid") return PlayerStats::Rapid;
+                if (timeClass == "daily") return PlayerStats::Daily;
+            } else if (rules == "chess960" && timeClass == "daily") {
+                return PlayerStats::Daily960;
+            }
+            return -1;
+        }
+
+        void finish() {
+            const int m = mode(game.timeClass, game.rules);
+            const int color = game.sides[0].username == owner ? 0 : game.sides[1].username == owner ? 1 : -1;
+            if (!game.rated || m < 0 || color < 0) {
+                ++skipped;
+                return;
+            }
+            const Side& me = game.sides[color];
+            const Side& them = game.sides[1 - color];
+            int result = me.result == "win" ? 2 : them.result == "win" ? 0 : isDraw(me.result) ? 1 : -1;
+            if (result < 0 || me.rating < 0 || them.rating < 0) {
+                ++skipped;
+                return;
+            }
+            ArchiveGame g;
+            g.endTime = game.endTime;
+            g.opponent = them.username;
+            g.mode = static_cast<uint8_t>(m);
+            g.color = static_cast<uint8_t>(color);
+            g.result = static_cast<uint8_t>(result);
+            g.ratingAfter = static_cast<int16_t>(me.rating);
+            g.opponentRating = static_cast<int16_t>(them.rating);
+            out.push_back(std::move(g));
+        }
+    };
+};
+
+#endif // ARCHIVE_INGESTER_H
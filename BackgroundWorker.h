@@ -0,0 +1,88 @@
+#ifndef BACKGROUND_WORKER_H
+#define BACKGROUND_WORKER_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// One background thread running the most recent job. Submitting a job
+// supersedes the previous one: a job still waiting is dropped, and a running
+// one sees its `cancelled` predicate turn true and is expected to stop at the
+// next check. Jobs are tagged with a generation number so results that arrive
+// late can be recognised as stale.
+class BackgroundWorker {
+public:
+    typedef std::function<bool()> Cancelled;
+    typedef std::function<void(unsigned generation, const Cancelled& cancelled)> Job;
+
+    BackgroundWorker() : generation(0), stopping(false), thread([this]() { run(); }) {}
+
+    ~BackgroundWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            ++generation;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    BackgroundWorker(const BackgroundWorker&) = delete;
+    BackgroundWorker& operator=(const BackgroundWorker&) = delete;
+
+    // Queues `job` and returns its generation.
+    unsigned submit(Job job) {
+        unsigned gen;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = std::move(job);
+            gen = ++generation;
+        }
+        wake.notify_one();
+        return gen;
+    }
+
+    // Cancels whatever is pending or running.
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = nullptr;
+        ++generation;
+    }
+
+    bool isCurrent(unsigned gen) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return gen == generation && !stopping;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    Job pending;
+    unsigned generation;
+    bool stopping;
+    std::thread thread; // last, so it starts after the members it uses
+
+    void run() {
+        for (;;) {
+            Job job;
+            unsigned gen;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || pending; });
+                if (stopping) return;
+                job.swap(pending);
+                gen = generation;
+            }
+            try {
+                job(gen, [this, gen]() { return !isCurrent(gen); });
+            } catch (const std::exception& ex) {
+                std::cerr << "Error: " << ex.what() << std::endl;
+            }
+        }
+    }
+};
+
+#endif // BACKGROUND_WORKER_H
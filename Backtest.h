@@ -0,0 +1,291 @@
+#ifndef BACKTEST_H
+#define BACKTEST_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include "GameStore.h"
+#include "Glicko.h"
+#include "ParallelFor.h"
+#include "StatsExtractor.h"
+
+// Count and sums of prediction errors, without the histogram. Floating-point
+// sums depend on the order they are added in, so parallel callers keep one of
+// these per unit of work and merge them in a fixed order.
+struct ErrorSums {
+    size_t games;
+    double sum, sumAbs, sumSq;
+
+    ErrorSums() : games(0), sum(0), sumAbs(0), sumSq(0) {}
+
+    void add(double error) {
+        ++games;
+        sum += error;
+        sumAbs += std::abs(error);
+        sumSq += error * error;
+    }
+};
+
+// Distribution of prediction errors (predicted minus actual post-game
+// rating). |error| is kept in a 0.1-point histogram up to 50 points, so
+// quantiles need no stored samples and partial results merge exactly.
+struct ErrorStats {
+    static const int kBins = 501; // last bin: 50 and above
+    size_t games;
+    double sum, sumAbs, sumSq;
+    std::vector<uint32_t> histogram;
+
+    ErrorStats() : games(0), sum(0), sumAbs(0), sumSq(0), histogram(kBins, 0) {}
+
+    void add(double error) {
+        ++games;
+        sum += error;
+        sumAbs += std::abs(error);
+        sumSq += error * error;
+        count(error);
+    }
+
+    // Histogram only; the sums come separately through merge(ErrorSums).
+    void count(double error) {
+        ++histogram[std::min(kBins - 1, static_cast<int>(std::abs(error) * 10))];
+    }
+
+    void merge(const ErrorStats& o) {
+        games += o.games;
+        sum += o.sum;
+        sumAbs += o.sumAbs;
+        sumSq += o.sumSq;
+        for (int b = 0; b < kBins; ++b) histogram[b] += o.histogram[b];
+    }
+
+    void merge(const ErrorSums& o) {
+        games += o.games;
+        sum += o.sum;
+        sumAbs += o.sumAbs;
+        sumSq += o.sumSq;
+    }
+
+    double mean() const { return games ? sum / games : 0; }
+    double meanAbs() const { return games ? sumAbs / games : 0; }
+    double rmse() const { return games ? std::sqrt(sumSq / games) : 0; }
+
+    // Upper edge of the bin holding the f-quantile of |error|.
+    double quantileAbs(double f) const {
+        size_t target = static_cast<size_t>(std::ceil(f * games)), seen = 0;
+        for (int b = 0; b < kBins; ++b) {
+            seen += histogram[b];
+            if (seen >= target && seen > 0) return (b + 1) / 10.0;
+        }
+        return 0;
+    }
+};
+
+// Replays the stored games of every player through the Glicko-1 update and
+// compares the predicted post-game rating with the one Chess.com assigned.
+//
+// Inputs per game come from the GameStore row: the player's rating before
+// (their previous post-game rating in the mode) and the score. The archives
+// carry no RDs and no pre-game rating for the opponent, so:
+//   - the player's RD is tracked through their games with the Glicko RD
+//     update, growing by c per idle day up to maxRD as in
+//     RatingPeriodEngine, and starting from initialRD;
+//   - the opponent's rating before is estimated as their rating after plus
+//     the player's actual change (the two moves mirror each other when the
+//     RDs are equal), and their RD is `opponentRD`.
+// The first `warmupGames` games of a player and mode only settle the RD
+// estimate and are not scored.
+//
+// Several (RD floor, q) variants are replayed in the same pass, each with
+// its own RD track, so the 55 clamp and the q constant can be checked
+// against alternatives on identical data. Errors are reported overall, per
+// time class and per band of the RD in use.
+//
+// The store is read a block of rows at a time. Inside a block the rows are
+// grouped by player and the groups are spread over parallelFor's
+// work-stealing workers; per-player state carries over between blocks, so
+// memory is the block plus a few doubles per player, mode and variant.
+// Histograms are integer counts and merge per worker. Error sums are kept
+// per player group and added up in player order, so the report is the same
+// for any thread count.
+class Backtest {
+public:
+    struct Variant {
+        double rdFloor;
+        double q;
+    };
+
+    struct Config {
+        std::vector<Variant> variants;  // default: the current model
+        std::vector<double> rdBandEdges; // bands [floor, e0), [e0, e1), ..., [eN, maxRD]
+        double initialRD;
+        double maxRD;
+        double c;                       // RD growth per idle day
+        double opponentRD;
+        int warmupGames;
+        size_t blockRows;
+        unsigned threads;               // 0 = all cores
+
+        Config()
+            : variants(1, Variant{kChessComRDFloor, ::q}), rdBandEdges({60, 80, 110, 150}), initialRD(150),
+              maxRD(350), c(34.6), opponentRD(60), warmupGames(10), blockRows(1 << 20), threads(0) {}
+    };
+
+    struct VariantReport {
+        Variant variant;
+        ErrorStats overall;
+        ErrorStats byMode[PlayerStats::kModes];
+        std::vector<ErrorStats> byRDBand; // one more than rdBandEdges
+    };
+
+    struct Report {
+        size_t players; // players with at least one stored game
+        size_t rows;
+        size_t scored;  // games scored per variant
+        double seconds;
+        std::vector<double> rdBandEdges;
+        std::vector<VariantReport> variants;
+    };
+
+    static Report run(const GameStore& store, const Config& config = Config()) {
+        auto start = std::chrono::steady_clock::now();
+        if (config.variants.empty() || config.blockRows == 0) {
+            throw std::invalid_argument("Backtest: no variants or empty blocks");
+        }
+        const size_t V = config.variants.size();
+        const size_t bands = config.rdBandEdges.size() + 1;
+        const unsigned threads = workerCount(config.threads);
+
+        std::vector<Track> tracks(store.players() * PlayerStats::kModes * V);
+        std::vector<char> seen(store.players(), 0);
+        std::vector<std::vector<VariantReport>> partial(threads, blank(config, bands));
+        Report report;
+        report.variants = blank(config, bands);
+
+        const size_t slots = slotsPerVariant(bands) * V;
+        std::vector<ErrorSums> groupSums;
+        GameStore::Columns block;
+        std::vector<uint32_t> order;
+        std::vector<size_t> groups;
+        for (size_t first = 0; first < store.rows(); first += config.blockRows) {
+            store.read(first, config.blockRows, block);
+            const size_t n = block.size();
+            order.resize(n);
+            std::iota(order.begin(), order.end(), 0u);
+            std::stable_sort(order.begin(), order.end(),
+                             [&](uint32_t a, uint32_t b) { return block.player[a] < block.player[b]; });
+            groups.clear();
+            for (size_t i = 0; i < n; ++i) {
+                if (i == 0 || block.player[order[i]] != block.player[order[i - 1]]) groups.push_back(i);
+            }
+            groups.push_back(n);
+
+            groupSums.assign((groups.size() - 1) * slots, ErrorSums());
+            parallelFor(0, groups.size() - 1, 1, [&](size_t lo, size_t hi, unsigned worker) {
+                for (size_t g = lo; g < hi; ++g) {
+                    seen[block.player[order[groups[g]]]] = 1;
+                    for (size_t k = groups[g]; k < groups[g + 1]; ++k) {
+                        replay(config, block, order[k], tracks, partial[worker], &groupSums[g * slots]);
+                    }
+                }
+            }, threads);
+            for (size_t g = 0; g + 1 < groups.size(); ++g) {
+                const ErrorSums* sums = &groupSums[g * slots];
+                for (size_t v = 0; v < V; ++v) {
+                    VariantReport& r = report.variants[v];
+                    r.overall.merge(*sums++);
+                    for (int m = 0; m < PlayerStats::kModes; ++m) r.byMode[m].merge(*sums++);
+                    for (size_t b = 0; b < bands; ++b) r.byRDBand[b].merge(*sums++);
+                }
+            }
+        }
+
+        report.rows = store.rows();
+        report.players = static_cast<size_t>(std::count(seen.begin(), seen.end(), 1));
+        report.rdBandEdges = config.rdBandEdges;
+        for (const std::vector<VariantReport>& p : partial) { // histograms only
+            for (size_t v = 0; v < V; ++v) {
+                report.variants[v].overall.merge(p[v].overall);
+                for (int m = 0; m < PlayerStats::kModes; ++m) report.variants[v].byMode[m].merge(p[v].byMode[m]);
+                for (size_t b = 0; b < bands; ++b) report.variants[v].byRDBand[b].merge(p[v].byRDBand[b]);
+            }
+        }
+        report.scored = report.variants[0].overall.games;
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+private:
+    // One player's RD estimate in one mode under one variant.
+    struct Track {
+        double RD;
+        int64_t lastEndTime;
+        int games;
+
+        Track() : RD(-1), lastEndTime(0), games(0) {}
+    };
+
+    static std::vector<VariantReport> blank(const Config& config, size_t bands) {
+        std::vector<VariantReport> reports(config.variants.size());
+        for (size_t v = 0; v < reports.size(); ++v) {
+            reports[v].variant = config.variants[v];
+            reports[v].byRDBand.resize(bands);
+        }
+        return reports;
+    }
+
+    // Error sums per variant: overall, one per mode, one per RD band.
+    static size_t slotsPerVariant(size_t bands) { return 1 + PlayerStats::kModes + bands; }
+
+    // Counts the error into the worker's histograms in `out` and its sums
+    // into the player group's `sums`.
+    static void replay(const Config& config, const GameStore::Columns& block, size_t row, std::vector<Track>& tracks,
+                       std::vector<VariantReport>& out, ErrorSums* sums) {
+        const size_t V = config.variants.size();
+        const int mode = block.mode[row];
+        if (mode >= PlayerStats::kModes) return;
+        const double before = block.ratingBefore[row], after = block.ratingAfter[row];
+        const double s = block.result[row] / 2.0;
+        const double oppBefore = block.opponentRating[row] + (after - before);
+
+        for (size_t v = 0; v < V; ++v) {
+            const Variant& variant = config.variants[v];
+            Track& t = tracks[(static_cast<size_t>(block.player[row]) * PlayerStats::kModes + mode) * V + v];
+            double RD = config.initialRD;
+            if (t.RD >= 0) {
+                double days = std::max<int64_t>(0, block.endTime[row] - t.lastEndTime) / 86400.0;
+                RD = std::min(std::sqrt(t.RD * t.RD + config.c * config.c * days), config.maxRD);
+            }
+            RD = std::max(RD, variant.rdFloor);
+            t.lastEndTime = block.endTime[row];
+
+            if (before < 0) { // first game in the store: nothing to predict from
+                t.RD = RD;
+                continue;
+            }
+            const double oppRD = std::max(config.opponentRD, variant.rdFloor);
+            double newRD;
+            const double predicted = glickoNewRating(before, RD, oppBefore, oppRD, s, variant.q, &newRD);
+            t.RD = newRD;
+            if (t.games++ < config.warmupGames) continue;
+
+            const double error = predicted - after;
+            VariantReport& r = out[v];
+            size_t band = std::upper_bound(config.rdBandEdges.begin(), config.rdBandEdges.end(), RD) -
+                          config.rdBandEdges.begin();
+            r.overall.count(error);
+            r.byMode[mode].count(error);
+            r.byRDBand[band].count(error);
+            ErrorSums* variantSums = sums + v * slotsPerVariant(r.byRDBand.size());
+            variantSums[0].add(error);
+            variantSums[1 + mode].add(error);
+            variantSums[1 + PlayerStats::kModes + band].add(error);
+        }
+    }
+};
+
+#endif // BACKTEST_H
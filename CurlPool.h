@@ -0,0 +1,252 @@
+#ifndef CURL_POOL_H
+#define CURL_POOL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <curl/curl.h>
+
+// Process-wide pool of libcurl easy handles for the Chess.com API.
+//
+// A fresh easy handle per request (what getPlayerStats used to do) pays for
+// DNS, TCP and a full TLS handshake every time. Handles here are returned to
+// the pool after use and keep their live connections, so a request after the
+// first one normally goes out on a warm connection. All handles share one
+// CURLSH holding the DNS cache and TLS session IDs, which libcurl allows
+// across threads; the connection cache is not shared, since libcurl does not
+// support using one (or multiplexing HTTP/2 streams over one connection) from
+// several threads at once. HTTP/2 is negotiated over TLS when the server
+// offers it. Every transfer is bounded by kConnectTimeout and kTimeout.
+class CurlPool {
+public:
+    struct Response {
+        long status;
+        std::string body;
+        double seconds;
+        double retryAfter; // seconds asked for by a Retry-After header, 0 if none
+    };
+
+    static const long kConnectTimeout = 10; // seconds
+    static const long kTimeout = 30;
+
+    static CurlPool& instance() {
+        static CurlPool pool;
+        return pool;
+    }
+
+    CurlPool(const CurlPool&) = delete;
+    CurlPool& operator=(const CurlPool&) = delete;
+
+    // Borrowed easy handle, configured with the shared cache and defaults.
+    // Goes back to the pool on destruction.
+    class Handle {
+    public:
+        Handle(CurlPool& pool, CURL* curl) : pool(&pool), curl(curl) {}
+        Handle(Handle&& other) : pool(other.pool), curl(other.curl) { other.curl = nullptr; }
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        ~Handle() {
+            if (curl) pool->release(curl);
+        }
+
+        CURL* get() const { return curl; }
+
+    private:
+        CurlPool* pool;
+        CURL* curl;
+    };
+
+    Handle acquire() {
+        CURL* curl = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                curl = idle.back();
+                idle.pop_back();
+            }
+        }
+        if (!curl) {
+            curl = curl_easy_init();
+            if (!curl) throw std::runtime_error("CurlPool: curl_easy_init failed");
+        }
+        // reset() clears options but keeps the handle's live connections and
+        // caches, so a reused handle is always configured the same way.
+        curl_easy_reset(curl);
+        configure(curl);
+        return Handle(*this, curl);
+    }
+
+    // Options every request gets. Exposed for handles driven elsewhere (for
+    // example by a curl_multi loop) that still want the shared caches.
+    void configure(CURL* curl) const {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, kConnectTimeout);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, kTimeout);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!caInfo.empty()) curl_easy_setopt(curl, CURLOPT_CAINFO, caInfo.c_str());
+    }
+
+    // CA bundle to verify servers against (e.g. a local mock's certificate).
+    void setCAInfo(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        caInfo = path;
+    }
+
+    // Blocking GET on a pooled handle. Throws std::runtime_error if the
+    // transfer fails; HTTP error statuses are returned, not thrown.
+    Response get(const std::string& url) {
+        Handle handle = acquire();
+        return perform(handle.get(), url);
+    }
+
+    // As get(), but the transfer is stopped once `abort` returns true. libcurl
+    // polls it from the progress callback several times a second, also
+    // while waiting on a stalled connection. Throws "Cancelled" then.
+    Response get(const std::string& url, const std::function<bool()>& abort) {
+        Handle handle = acquire();
+        curl_easy_setopt(handle.get(), CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(handle.get(), CURLOPT_XFERINFOFUNCTION, abortIf);
+        curl_easy_setopt(handle.get(), CURLOPT_XFERINFODATA, &abort);
+        try {
+            return perform(handle.get(), url);
+        } catch (const std::runtime_error&) {
+            if (abort()) throw std::runtime_error("Cancelled");
+            throw;
+        }
+    }
+
+    size_t idleHandles() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return idle.size();
+    }
+
+    struct LatencyReport {
+        int requests;
+        double coldMean, coldMedian; // seconds, fresh unshared handle per request
+        double pooledMean, pooledMedian;
+    };
+
+    // Latency of `requests` sequential GETs to `url` with a cold handle per
+    // request versus the pool. Point it at a local mock server to isolate the
+    // connection and handshake cost from the network; curl_bench runs it
+    // against bench/MockServer.h over HTTP/2 and HTTP/1.1.
+    static LatencyReport benchmark(const std::string& url, int requests = 50) {
+        CurlPool& pool = instance();
+        std::vector<double> cold, pooled;
+        for (int i = 0; i < requests; ++i) {
+            CURL* curl = curl_easy_init();
+            if (!curl) throw std::runtime_error("CurlPool: curl_easy_init failed");
+            pool.configure(curl);
+            curl_easy_setopt(curl, CURLOPT_SHARE, (CURLSH*)nullptr);
+            curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+            try {
+                cold.push_back(perform(curl, url).seconds);
+            } catch (...) {
+                curl_easy_cleanup(curl);
+                throw;
+            }
+            curl_easy_cleanup(curl);
+        }
+        pool.get(url); // warm up
+        for (int i = 0; i < requests; ++i) {
+            pooled.push_back(pool.get(url).seconds);
+        }
+
+        LatencyReport report;
+        report.requests = requests;
+        summarize(cold, report.coldMean, report.coldMedian);
+        summarize(pooled, report.pooledMean, report.pooledMedian);
+        return report;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<CURL*> idle;
+    CURLSH* share;
+    struct curl_slist* headers;
+    std::string caInfo;
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+    CurlPool() : share(nullptr), headers(nullptr) {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        share = curl_share_init();
+        if (!share) throw std::runtime_error("CurlPool: curl_share_init failed");
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        headers = curl_slist_append(headers, "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/58.0.3029.110 Safari/537.3");
+    }
+
+    ~CurlPool() {
+        for (CURL* curl : idle) curl_easy_cleanup(curl);
+        curl_share_cleanup(share);
+        curl_slist_free_all(headers);
+        curl_global_cleanup();
+    }
+
+    void release(CURL* curl) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(curl);
+    }
+
+    static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userp) {
+        static_cast<CurlPool*>(userp)->shareLocks[data].lock();
+    }
+
+    static void unlockShare(CURL*, curl_lock_data data, void* userp) {
+        static_cast<CurlPool*>(userp)->shareLocks[data].unlock();
+    }
+
+    static int abortIf(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        return (*static_cast<const std::function<bool()>*>(clientp))() ? 1 : 0;
+    }
+
+    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
+        size_t totalSize = size * nmemb;
+        userp->append((char*)contents, totalSize);
+        return totalSize;
+    }
+
+    static Response perform(CURL* curl, const std::string& url) {
+        Response response;
+        response.status = 0;
+        response.retryAfter = 0;
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response.body);
+        auto start = std::chrono::steady_clock::now();
+        CURLcode res = curl_easy_perform(curl);
+        response.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (res != CURLE_OK) {
+            throw std::runtime_error(std::string("Failed to fetch data from Chess.com API: ") + curl_easy_strerror(res));
+        }
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status);
+        curl_off_t retryAfter = 0;
+        curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter);
+        response.retryAfter = static_cast<double>(retryAfter);
+        return response;
+    }
+
+    static void summarize(std::vector<double> v, double& mean, double& median) {
+        mean = median = 0;
+        if (v.empty()) return;
+        for (double x : v) mean += x;
+        mean /= v.size();
+        std::sort(v.begin(), v.end());
+        median = v[v.size() / 2];
+    }
+};
+
+#endif // CURL_POOL_H
@@ -0,0 +1,174 @@
+#ifndef DECISION_SURFACE_H
+#define DECISION_SURFACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Glicko.h"
+#include "RiskModel.h"
+#include "RiskScreen.h"
+
+// Precomputed analyzeRisk decisions for one player rating and RD: a dense
+// table over (opponent rating, opponent RD) for every abort-belief state, so
+// the decision at match start is a single array read.
+//
+// Opponent RDs below the 55 floor are clamped exactly as calculateRatingRes
+// does, so the RD axis starts at the floor. Ratings are stored in a window
+// around the player's rating; anything outside the table is answered by the
+// exact model instead.
+class DecisionSurface {
+public:
+    struct Config {
+        int ratingRadius; // opponent ratings player +- ratingRadius
+        int maxRD;
+        RiskParams params;
+
+        Config() : ratingRadius(1000), maxRD(350) {}
+    };
+
+    DecisionSurface(int playerRating, int playerRD, const Config& config = Config())
+        : playerRating(playerRating), playerRD(playerRD), config(config),
+          minRating(playerRating - config.ratingRadius),
+          ratings(2 * config.ratingRadius + 1),
+          minRD(static_cast<int>(kChessComRDFloor)),
+          rds(std::max(0, config.maxRD - static_cast<int>(kChessComRDFloor) + 1)),
+          states(AbortBelief().stateCount()) {}
+
+    // Fills the table one RD row at a time through RiskScreen. Returns false
+    // if `cancel` was raised before it finished.
+    bool build(const std::atomic<bool>* cancel = nullptr) {
+        table.assign(static_cast<size_t>(states) * rds * ratings, 0);
+        std::vector<double> oppRating(ratings), oppRD(ratings);
+        for (int k = 0; k < ratings; ++k) oppRating[k] = minRating + k;
+
+        std::vector<AbortBelief> beliefs;
+        for (int s = 0; s < states; ++s) beliefs.push_back(AbortBelief::afterAborts(s));
+
+        for (int row = 0; row < rds; ++row) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) return false;
+            std::fill(oppRD.begin(), oppRD.end(), minRD + row);
+            RiskColumns cols = RiskScreen::screen(playerRating, playerRD, oppRating, oppRD, beliefs[0],
+                                                  config.params);
+            // The EV columns do not depend on the belief; only decideRisk does.
+            for (int s = 0; s < states; ++s) {
+                uint8_t* out = &table[index(s, row, 0)];
+                int possible = beliefs[s].possibleStates();
+                double left = beliefs[s].expectedAbortsLeft();
+                for (int k = 0; k < ratings; ++k) {
+                    out[k] = static_cast<uint8_t>(decideRisk(playerRating, cols.win[k], cols.lose[k],
+                                                             cols.expectedValue[k], cols.riskRewardRatio[k],
+                                                             cols.adjustedExpectedValue[k], possible, left,
+                                                             config.params));
+                }
+            }
+        }
+        return true;
+    }
+
+    bool covers(int oppRating, int oppRD) const {
+        int rd = std::max(oppRD, minRD);
+        return oppRating >= minRating && oppRating < minRating + ratings && rd < minRD + rds;
+    }
+
+    // O(1) decision; abortsUsed is how many aborts have been taken so far.
+    RiskDecision lookup(int oppRating, int oppRD, int abortsUsed) const {
+        if (!covers(oppRating, oppRD)) return evaluate(oppRating, oppRD, abortsUsed);
+        int s = std::min(std::max(abortsUsed, 0), states - 1);
+        int row = std::max(oppRD, minRD) - minRD;
+        return static_cast<RiskDecision>(table[index(s, row, oppRating - minRating)]);
+    }
+
+    // The exact model, for cells outside the table.
+    RiskDecision evaluate(int oppRating, int oppRD, int abortsUsed) const {
+        double RD = std::max<double>(playerRD, kChessComRDFloor);
+        double RD_j = std::max<double>(oppRD, kChessComRDFloor);
+        RatingOutcomes o = glickoOutcomes(playerRating, RD, oppRating, RD_j);
+        AbortBelief belief = AbortBelief::afterAborts(std::min(std::max(abortsUsed, 0), states - 1));
+        return evaluateRisk(playerRating, oppRating, o.win, o.lose, o.draw, RD, RD_j, belief,
+                            config.params).decision;
+    }
+
+    int rating() const { return playerRating; }
+    int RD() const { return playerRD; }
+
+private:
+    int playerRating, playerRD;
+    Config config;
+    int minRating, ratings;
+    int minRD, rds;
+    int states;
+    std::vector<uint8_t> table; // [state][RD row][rating]
+
+    size_t index(int s, int row, int k) const {
+        return (static_cast<size_t>(s) * rds + row) * ratings + k;
+    }
+};
+
+// Keeps a DecisionSurface for the player's current rating. update() starts a
+// background rebuild when the rating or RD changes; lookups keep using the
+// exact model until the new table is published.
+class DecisionSurfaceCache {
+public:
+    explicit DecisionSurfaceCache(DecisionSurface::Config config = DecisionSurface::Config())
+        : config(config), cancel(false) {}
+
+    ~DecisionSurfaceCache() {
+        stopBuilder();
+    }
+
+    DecisionSurfaceCache(const DecisionSurfaceCache&) = delete;
+    DecisionSurfaceCache& operator=(const DecisionSurfaceCache&) = delete;
+
+    void update(int playerRating, int playerRD) {
+        std::shared_ptr<const DecisionSurface> cur = std::atomic_load(&surface);
+        if (cur && cur->rating() == playerRating && cur->RD() == playerRD) return;
+        if (builder.joinable() && pendingRating == playerRating && pendingRD == playerRD) return;
+
+        stopBuilder();
+        cancel.store(false);
+        pendingRating = playerRating;
+        pendingRD = playerRD;
+        DecisionSurface::Config cfg = config;
+        builder = std::thread([this, playerRating, playerRD, cfg]() {
+            std::shared_ptr<DecisionSurface> next = std::make_shared<DecisionSurface>(playerRating, playerRD, cfg);
+            if (next->build(&cancel)) {
+                std::atomic_store(&surface, std::shared_ptr<const DecisionSurface>(next));
+            }
+        });
+    }
+
+    // Decision for the pairing. The table is used when it matches the player;
+    // otherwise the decision is computed directly.
+    RiskDecision decide(int playerRating, int playerRD, int oppRating, int oppRD, int abortsUsed) const {
+        std::shared_ptr<const DecisionSurface> cur = std::atomic_load(&surface);
+        if (cur && cur->rating() == playerRating && cur->RD() == playerRD) {
+            return cur->lookup(oppRating, oppRD, abortsUsed);
+        }
+        return DecisionSurface(playerRating, playerRD, config).evaluate(oppRating, oppRD, abortsUsed);
+    }
+
+    bool ready(int playerRating, int playerRD) const {
+        std::shared_ptr<const DecisionSurface> cur = std::atomic_load(&surface);
+        return cur && cur->rating() == playerRating && cur->RD() == playerRD;
+    }
+
+private:
+    DecisionSurface::Config config;
+    std::shared_ptr<const DecisionSurface> surface;
+    std::atomic<bool> cancel;
+    std::thread builder;
+    int pendingRating = 0, pendingRD = 0;
+
+    void stopBuilder() {
+        if (builder.joinable()) {
+            cancel.store(true);
+            builder.join();
+        }
+    }
+};
+
+#endif // DECISION_SURFACE_H
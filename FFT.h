@@ -0,0 +1,57 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// Iterative radix-2 Cooley-Tukey FFT, in place. The size must be a power of
+// two. The inverse transform includes the 1/n scaling.
+inline void fft(std::vector<std::complex<double>>& a, bool inverse = false) {
+    const size_t n = a.size();
+    if (n == 0 || (n & (n - 1)) != 0) {
+        throw std::invalid_argument("fft: size must be a power of two");
+    }
+
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+
+    // Twiddles are computed directly per level rather than by repeated
+    // multiplication, which would accumulate rounding error over long rows.
+    const double sign = inverse ? 1.0 : -1.0;
+    std::vector<std::complex<double>> w(n / 2);
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const size_t half = len / 2;
+        const double theta = sign * 2 * 3.14159265358979323846 / len;
+        for (size_t k = 0; k < half; ++k) {
+            w[k] = std::complex<double>(std::cos(theta * k), std::sin(theta * k));
+        }
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < half; ++k) {
+                std::complex<double> u = a[i + k];
+                std::complex<double> v = a[i + k + half] * w[k];
+                a[i + k] = u + v;
+                a[i + k + half] = u - v;
+            }
+        }
+    }
+
+    if (inverse) {
+        for (std::complex<double>& x : a) x /= static_cast<double>(n);
+    }
+}
+
+// Smallest power of two >= n.
+inline size_t fftSize(size_t n) {
+    size_t size = 1;
+    while (size < n) size <<= 1;
+    return size;
+}
+
+#endif // FFT_H
@@ -0,0 +1,373 @@
+#ifndef GAME_STORE_H
+#define GAME_STORE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "StatsExtractor.h"
+
+// One rated game from a monthly archive, seen from the archive owner's side.
+struct ArchiveGame {
+    int64_t endTime; // unix seconds
+    std::string opponent;
+    uint8_t mode;    // PlayerStats::Mode
+    uint8_t color;   // 0 white, 1 black
+    uint8_t result;  // owner's score * 2: 0 loss, 1 draw, 2 win
+    int16_t ratingAfter;
+    int16_t opponentRating; // after the game too
+};
+
+// Append-only columnar store of archive games, one row per game per tracked
+// player. Each column is a flat binary file of fixed-width values in a
+// directory, so a scan reads only the columns it needs:
+//
+//   end_time.i64  player.u32  opponent.u32  mode.u8  color.u8  result.u8
+//   rating_before.i16  rating_after.i16  opponent_rating.i16
+//
+// Usernames are interned into usernames.txt (line n is id n; a torn last
+// line is dropped on open). Rows become visible when commit() writes the row
+// count to `rows`; on open, columns are cut back to that count, so an
+// interrupted append leaves no torn rows. The per-player sync marks are
+// written to the same file, so they always agree with the rows.
+//
+// The archives only give ratings after each game. rating_before is the
+// owner's previous rating in the same mode, or -1 for their first game in
+// the store. Rows of one player and mode must therefore be appended in time
+// order.
+//
+// Not thread-safe; one writer at a time.
+class GameStore {
+public:
+    // A block of rows, one vector per column.
+    struct Columns {
+        std::vector<int64_t> endTime;
+        std::vector<uint32_t> player;
+        std::vector<uint32_t> opponent;
+        std::vector<uint8_t> mode;
+        std::vector<uint8_t> color;
+        std::vector<uint8_t> result;
+        std::vector<int16_t> ratingBefore;
+        std::vector<int16_t> ratingAfter;
+        std::vector<int16_t> opponentRating;
+
+        size_t size() const { return endTime.size(); }
+    };
+
+    // How far a player's archive has been read: the newest month fetched
+    // ("YYYY/MM"), the end time of the newest stored game, and how many
+    // stored games ended in that same second, since several can.
+    struct SyncMark {
+        std::string month;
+        int64_t lastEndTime;
+        uint32_t atLastEndTime; // kAllAtLastEndTime for marks written before it was kept
+
+        SyncMark() : lastEndTime(0), atLastEndTime(0) {}
+    };
+
+    static const uint32_t kAllAtLastEndTime = UINT32_MAX;
+
+    explicit GameStore(const std::string& dir) : dir(dir), committed(0), pending(0), lastRatingsLoaded(false) {
+        if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("GameStore: cannot create " + dir + ": " + std::strerror(errno));
+        }
+        std::ifstream rowsIn(file("rows"));
+        unsigned long long rows = 0;
+        if (rowsIn >> rows) committed = static_cast<size_t>(rows);
+        std::string line;
+        std::getline(rowsIn, line); // rest of the count line
+        while (std::getline(rowsIn, line)) {
+            std::istringstream in(line);
+            uint32_t player;
+            SyncMark mark;
+            if (!(in >> player >> mark.month >> mark.lastEndTime)) continue;
+            if (!(in >> mark.atLastEndTime)) mark.atLastEndTime = kAllAtLastEndTime;
+            marks[player] = mark;
+        }
+
+        // A crash while a name was being written leaves a torn last line.
+        // Cut it off, or the next name appended would be glued onto it and
+        // every later id would shift.
+        std::string names;
+        {
+            std::ifstream in(file("usernames.txt"), std::ios::binary);
+            names.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        const size_t complete = names.rfind('\n') == std::string::npos ? 0 : names.rfind('\n') + 1;
+        if (complete < names.size()) {
+            if (::truncate(file("usernames.txt").c_str(), static_cast<off_t>(complete)) != 0) {
+                throw std::runtime_error("GameStore: cannot truncate " + file("usernames.txt"));
+            }
+            names.resize(complete);
+        }
+        for (size_t start = 0; start < names.size();) {
+            size_t end = names.find('\n', start);
+            std::string name = names.substr(start, end - start);
+            ids.emplace(name, static_cast<uint32_t>(usernames.size()));
+            usernames.push_back(name);
+            start = end + 1;
+        }
+
+        for (int c = 0; c < kColumns; ++c) {
+            const std::string path = file(columnFile(c));
+            FILE* f = std::fopen(path.c_str(), "ab");
+            if (!f) throw std::runtime_error("GameStore: cannot open " + path);
+            std::fclose(f);
+            if (::truncate(path.c_str(), static_cast<off_t>(committed * columnWidth(c))) != 0) {
+                throw std::runtime_error("GameStore: cannot truncate " + path);
+            }
+            columns[c] = std::fopen(path.c_str(), "ab");
+            if (!columns[c]) throw std::runtime_error("GameStore: cannot open " + path);
+        }
+        namesOut = std::fopen(file("usernames.txt").c_str(), "ab");
+        if (!namesOut) throw std::runtime_error("GameStore: cannot open " + file("usernames.txt"));
+    }
+
+    ~GameStore() {
+        for (FILE* f : columns) std::fclose(f);
+        std::fclose(namesOut);
+    }
+
+    GameStore(const GameStore&) = delete;
+    GameStore& operator=(const GameStore&) = delete;
+
+    // Committed rows.
+    size_t rows() const { return committed; }
+
+    size_t players() const { return usernames.size(); }
+
+    // Id of `username` (case-insensitive), adding it if new.
+    uint32_t intern(const std::string& username) {
+        std::string key = lower(username);
+        auto it = ids.find(key);
+        if (it != ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(usernames.size());
+        ids.emplace(key, id);
+        usernames.push_back(key);
+        std::fprintf(namesOut, "%s\n", key.c_str());
+        return id;
+    }
+
+    // Id of `username`, or -1 if it has never been stored.
+    long find(const std::string& username) const {
+        auto it = ids.find(lower(username));
+        return it == ids.end() ? -1 : static_cast<long>(it->second);
+    }
+
+    const std::string& username(uint32_t id) const { return usernames.at(id); }
+
+    // Owner's last stored rating in `mode`, or -1.
+    int lastRating(uint32_t player, int mode) {
+        loadLastRatings();
+        auto it = lastRatings.find(ratingKey(player, mode));
+        return it == lastRatings.end() ? -1 : it->second;
+    }
+
+    bool syncMark(uint32_t player, SyncMark& out) const {
+        auto it = marks.find(player);
+        if (it == marks.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    // Takes effect with the next commit().
+    void setSyncMark(uint32_t player, const SyncMark& mark) { pendingMarks[player] = mark; }
+
+    // Appends one player's games, oldest first. They become visible at the
+    // next commit().
+    void append(const std::string& owner, const std::vector<ArchiveGame>& games) {
+        if (games.empty()) return;
+        loadLastRatings();
+        const uint32_t player = intern(owner);
+        Columns block;
+        for (const ArchiveGame& g : games) {
+            int16_t& last = lastRatingSlot(player, g.mode);
+            block.endTime.push_back(g.endTime);
+            block.player.push_back(player);
+            block.opponent.push_back(intern(g.opponent));
+            block.mode.push_back(g.mode);
+            block.color.push_back(g.color);
+            block.result.push_back(g.result);
+            block.ratingBefore.push_back(last);
+            block.ratingAfter.push_back(g.ratingAfter);
+            block.opponentRating.push_back(g.opponentRating);
+            last = g.ratingAfter;
+        }
+        write(block);
+    }
+
+    // Makes every appended row visible and durable against a crash of this
+    // process or of the machine: the data is synced before the row count is
+    // renamed into place, and the directory after, so the rename itself
+    // survives a power loss.
+    void commit() {
+        for (FILE* f : columns) flush(f);
+        flush(namesOut);
+        const std::string tmp = file("rows.tmp");
+        FILE* f = std::fopen(tmp.c_str(), "w");
+        if (!f) throw std::runtime_error("GameStore: cannot write " + tmp);
+        std::fprintf(f, "%llu\n", static_cast<unsigned long long>(committed + pending));
+        std::map<uint32_t, SyncMark> next = marks;
+        for (const auto& m : pendingMarks) next[m.first] = m.second;
+        for (const auto& m : next) {
+            std::fprintf(f, "%u %s %lld %u\n", m.first, m.second.month.c_str(),
+                         static_cast<long long>(m.second.lastEndTime), m.second.atLastEndTime);
+        }
+        flush(f);
+        std::fclose(f);
+        if (std::rename(tmp.c_str(), file("rows").c_str()) != 0) {
+            throw std::runtime_error("GameStore: cannot commit " + file("rows"));
+        }
+        syncDir();
+        committed += pending;
+        pending = 0;
+        marks.swap(next);
+        pendingMarks.clear();
+    }
+
+    // Reads committed rows [first, first + count) into `out`.
+    void read(size_t first, size_t count, Columns& out) const {
+        if (first > committed) first = committed;
+        count = std::min(count, committed - first);
+        readColumn(EndTime, first, count, out.endTime);
+        readColumn(Player, first, count, out.player);
+        readColumn(Opponent, first, count, out.opponent);
+        readColumn(Mode, first, count, out.mode);
+        readColumn(Color, first, count, out.color);
+        readColumn(Result, first, count, out.result);
+        readColumn(RatingBefore, first, count, out.ratingBefore);
+        readColumn(RatingAfter, first, count, out.ratingAfter);
+        readColumn(OpponentRating, first, count, out.opponentRating);
+    }
+
+    // Calls fn(block, firstRow) over all committed rows, `blockRows` at a
+    // time, reusing one block so memory stays flat however large the store.
+    template <class F>
+    void scan(F fn, size_t blockRows = 1 << 16) const {
+        Columns block;
+        for (size_t first = 0; first < committed; first += blockRows) {
+            read(first, blockRows, block);
+            fn(static_cast<const Columns&>(block), first);
+        }
+    }
+
+private:
+    enum Column { EndTime, Player, Opponent, Mode, Color, Result, RatingBefore, RatingAfter, OpponentRating };
+    static const int kColumns = 9;
+
+    std::string dir;
+    size_t committed;
+    size_t pending;
+    FILE* columns[kColumns];
+    FILE* namesOut;
+    std::vector<std::string> usernames;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::unordered_map<uint64_t, int16_t> lastRatings; // by ratingKey
+    std::map<uint32_t, SyncMark> marks, pendingMarks;  // by player id
+    bool lastRatingsLoaded;
+
+    static const char* columnFile(int c) {
+        static const char* const names[kColumns] = {"end_time.i64", "player.u32", "opponent.u32",
+                                                     "mode.u8", "color.u8", "result.u8",
+                                                     "rating_before.i16", "rating_after.i16", "opponent_rating.i16"};
+        return names[c];
+    }
+
+    static size_t columnWidth(int c) {
+        static const size_t widths[kColumns] = {8, 4, 4, 1, 1, 1, 2, 2, 2};
+        return widths[c];
+    }
+
+    std::string file(const std::string& name) const { return dir + "/" + name; }
+
+    static std::string lower(std::string s) {
+        for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    static uint64_t ratingKey(uint32_t player, int mode) { return (static_cast<uint64_t>(player) << 8) | mode; }
+
+    int16_t& lastRatingSlot(uint32_t player, int mode) {
+        return lastRatings.emplace(ratingKey(player, mode), static_cast<int16_t>(-1)).first->second;
+    }
+
+    // Built from the store the first time it is needed.
+    void loadLastRatings() {
+        if (lastRatingsLoaded) return;
+        lastRatingsLoaded = true;
+        std::vector<uint32_t> player;
+        std::vector<uint8_t> mode;
+        std::vector<int16_t> after;
+        const size_t blockRows = 1 << 16;
+        for (size_t first = 0; first < committed; first += blockRows) {
+            const size_t count = std::min(blockRows, committed - first);
+            readColumn(Player, first, count, player);
+            readColumn(Mode, first, count, mode);
+            readColumn(RatingAfter, first, count, after);
+            for (size_t i = 0; i < count; ++i) lastRatingSlot(player[i], mode[i]) = after[i];
+        }
+    }
+
+    template <class T>
+    void writeColumn(Column c, const std::vector<T>& values) {
+        if (std::fwrite(values.data(), sizeof(T), values.size(), columns[c]) != values.size()) {
+            throw std::runtime_error(std::string("GameStore: cannot write ") + columnFile(c));
+        }
+    }
+
+    void write(const Columns& block) {
+        writeColumn(EndTime, block.endTime);
+        writeColumn(Player, block.player);
+        writeColumn(Opponent, block.opponent);
+        writeColumn(Mode, block.mode);
+        writeColumn(Color, block.color);
+        writeColumn(Result, block.result);
+        writeColumn(RatingBefore, block.ratingBefore);
+        writeColumn(RatingAfter, block.ratingAfter);
+        writeColumn(OpponentRating, block.opponentRating);
+        pending += block.size();
+    }
+
+    template <class T>
+    void readColumn(Column c, size_t first, size_t count, std::vector<T>& out) const {
+        out.resize(count);
+        if (count == 0) return;
+        const std::string path = file(columnFile(c));
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) throw std::runtime_error("GameStore: cannot open " + path);
+        bool ok = ::fseeko(f, static_cast<off_t>(first * sizeof(T)), SEEK_SET) == 0 &&
+                  std::fread(out.data(), sizeof(T), count, f) == count;
+        std::fclose(f);
+        if (!ok) throw std::runtime_error("GameStore: short read from " + path);
+    }
+
+    void syncDir() const {
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) throw std::runtime_error("GameStore: cannot open " + dir + ": " + std::strerror(errno));
+        int rc = ::fsync(fd);
+        ::close(fd);
+        if (rc != 0) throw std::runtime_error("GameStore: cannot sync " + dir);
+    }
+
+    static void flush(FILE* f) {
+        if (std::fflush(f) != 0 || ::fsync(::fileno(f)) != 0) {
+            throw std::runtime_error("GameStore: flush failed");
+        }
+    }
+};
+
+#endif // GAME_STORE_H
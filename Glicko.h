@@ -0,0 +1,116 @@
+#ifndef GLICKO_H
+#define GLICKO_H
+
+#include <cmath>
+#include <cstddef>
+
+// Constants for the Glicko-1 system
+const double q = 0.0057565;
+const double pi = 3.14159265358979323846;
+
+// Lowest RD Chess.com appears to use (see the README's reverse engineering);
+// Game::calculateRatingRes clamps both RDs to it.
+const double kChessComRDFloor = 55;
+
+// Single-pairing Glicko-1 update (Step 2 in analyzer.h with one opponent).
+// This is the reference every other kernel is measured against, so keep the
+// operation order exactly as it is. `qc` replaces the q constant (e.g. to
+// backtest alternatives); if `newRD` is given it receives the post-game RD.
+inline double glickoNewRating(double r, double RD, double r_j, double RD_j, double s, double qc = q,
+                              double* newRD = nullptr) {
+    double gRD_j = 1 / std::sqrt(1 + 3 * std::pow(qc, 2) * std::pow(RD_j, 2) / std::pow(pi, 2));
+    double E = 1 / (1 + std::pow(10, -gRD_j * (r - r_j) / 400));
+    double sum = std::pow(gRD_j, 2) * E * (1 - E);
+    double sum_s_minus_E = gRD_j * (s - E);
+
+    double d_2 = 1 / (qc * qc * sum);
+    double denom = 1 / std::pow(RD, 2) + 1 / d_2;
+
+    double new_r = r + (qc / denom) * sum_s_minus_E;
+    if (newRD) *newRD = std::sqrt(1 / denom);
+    return new_r;
+}
+
+// Score-independent part of glickoNewRating for one pairing. Computing it once
+// and reusing it for every outcome costs one pow/sqrt pass instead of three,
+// and gives results bit-identical to glickoNewRating.
+struct GlickoTerms {
+    double r;
+    double gRD_j;
+    double E;
+    double denom; // 1/RD^2 + 1/d^2
+
+    GlickoTerms() : r(0), gRD_j(0), E(0), denom(0) {}
+
+    GlickoTerms(double r, double RD, double r_j, double RD_j) : r(r) {
+        gRD_j = 1 / std::sqrt(1 + 3 * std::pow(q, 2) * std::pow(RD_j, 2) / std::pow(pi, 2));
+        E = 1 / (1 + std::pow(10, -gRD_j * (r - r_j) / 400));
+        double sum = std::pow(gRD_j, 2) * E * (1 - E);
+        double d_2 = 1 / (q * q * sum);
+        denom = 1 / std::pow(RD, 2) + 1 / d_2;
+    }
+
+    double newRating(double s) const {
+        return r + (q / denom) * (gRD_j * (s - E));
+    }
+
+    double delta(double s) const {
+        return newRating(s) - r;
+    }
+
+    void deltas(const double* scores, double* out, size_t n) const {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = delta(scores[i]);
+        }
+    }
+
+    // RD' = sqrt((1/RD^2 + 1/d^2)^-1), the same for every outcome.
+    double newRD() const {
+        return std::sqrt(1 / denom);
+    }
+};
+
+// Post-game ratings for each outcome plus the post-game RD.
+struct RatingOutcomes {
+    double win;
+    double lose;
+    double draw;
+    double newRD;
+};
+
+inline RatingOutcomes glickoOutcomes(double r, double RD, double r_j, double RD_j) {
+    GlickoTerms terms(r, RD, r_j, RD_j);
+    RatingOutcomes out;
+    out.win = terms.newRating(1);
+    out.lose = terms.newRating(0);
+    out.draw = terms.newRating(0.5);
+    out.newRD = terms.newRD();
+    return out;
+}
+
+// Step 2 sums over one player's games in a rating period (analyzer.h):
+// 1/d^2 = q^2 sum g^2 E (1 - E) and sum g (s - E), taken against the
+// opponents' ratings and RDs at the onset of the period.
+struct GlickoPeriodSums {
+    double invD2;
+    double sumSMinusE;
+
+    GlickoPeriodSums() : invD2(0), sumSMinusE(0) {}
+
+    void add(double r, double r_j, double RD_j, double s) {
+        double gRD_j = 1 / std::sqrt(1 + 3 * q * q * RD_j * RD_j / (pi * pi));
+        double E = 1 / (1 + std::pow(10, -gRD_j * (r - r_j) / 400));
+        invD2 += gRD_j * gRD_j * E * (1 - E);
+        sumSMinusE += gRD_j * (s - E);
+    }
+
+    // r' and RD' from the onset rating and RD; RD' is kept at or above minRD.
+    void finish(double r, double RD, double minRD, double& outRating, double& outRD) const {
+        double denom = 1 / (RD * RD) + q * q * invD2;
+        outRating = r + (q / denom) * sumSMinusE;
+        outRD = std::sqrt(1 / denom);
+        if (outRD < minRD) outRD = minRD;
+    }
+};
+
+#endif // GLICKO_H
@@ -0,0 +1,301 @@
+#ifndef GLICKO2_H
+#define GLICKO2_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "Glicko.h"
+#include "ParallelFor.h"
+#include "RatingPeriodEngine.h"
+#include "SimdMath.h"
+
+// Glicko-2 (Glickman, "Example of the Glicko-2 system"). Ratings and RDs are
+// kept on the Glicko-1 scale at the interface and converted internally.
+
+// Player record from the README: rating, RD and volatility.
+struct Glicko2Player {
+    double rating;
+    double RD;
+    double volatility;
+};
+
+// One game of the period from the player's point of view.
+struct Glicko2Match {
+    double opponent_rating;
+    double opponent_RD;
+    double match_result;
+};
+
+class Glicko2 {
+public:
+    static constexpr double kScale = 173.7178;
+
+    struct Config {
+        double tau;       // constrains volatility change, 0.3-1.2
+        double epsilon;   // convergence tolerance of the volatility solve
+        int maxIterations;
+        unsigned threads; // 0 = all cores
+        bool simd;
+
+        Config() : tau(0.5), epsilon(1e-6), maxIterations(100), threads(0), simd(true) {}
+    };
+
+    static double g(double phi) {
+        return 1 / std::sqrt(1 + 3 * phi * phi / (pi * pi));
+    }
+
+    static double E(double mu, double mu_j, double phi_j) {
+        return 1 / (1 + std::exp(-g(phi_j) * (mu - mu_j)));
+    }
+
+    // f(x) from Step 5 of the algorithm; its root is ln(sigma'^2).
+    static double f(double x, double phi2, double v, double delta2, double a, double tau) {
+        double ex = std::exp(x);
+        double t = phi2 + v + ex;
+        return ex * (delta2 - phi2 - v - ex) / (2 * t * t) - (x - a) / (tau * tau);
+    }
+
+    // Step 5.2: initial bracket [A, B] around the root.
+    static void bracket(double phi2, double v, double delta2, double a, double tau,
+                        double& A, double& B) {
+        A = a;
+        if (delta2 > phi2 + v) {
+            B = std::log(delta2 - phi2 - v);
+        } else {
+            int k = 1;
+            while (f(a - k * tau, phi2, v, delta2, a, tau) < 0) {
+                ++k;
+            }
+            B = a - k * tau;
+        }
+    }
+
+    // Steps 5.1-5.5 for one player: Illinois (regula falsi) iteration on f.
+    static double solveVolatility(double phi2, double v, double delta2, double sigma,
+                                  const Config& config = Config()) {
+        const double tau = config.tau;
+        double a = std::log(sigma * sigma);
+        double A, B;
+        bracket(phi2, v, delta2, a, tau, A, B);
+        double fA = f(A, phi2, v, delta2, a, tau);
+        double fB = f(B, phi2, v, delta2, a, tau);
+        for (int it = 0; it < config.maxIterations && std::abs(B - A) > config.epsilon; ++it) {
+            double C = A + (A - B) * fA / (fB - fA);
+            double fC = f(C, phi2, v, delta2, a, tau);
+            if (fC * fB <= 0) {
+                A = B;
+                fA = fB;
+            } else {
+                fA /= 2;
+            }
+            B = C;
+            fB = fC;
+        }
+        return std::exp(A / 2);
+    }
+
+    // Batched volatility solve over SoA inputs. The AVX2 path runs four
+    // players per vector and keeps iterating until every lane's |B - A| is
+    // within epsilon; finished lanes are frozen by a mask.
+    static void solveVolatilities(const double* phi2, const double* v, const double* delta2,
+                                  const double* sigma, double* out, size_t n,
+                                  const Config& config = Config()) {
+        size_t i = 0;
+#if CHESS_RATING_X86_SIMD
+        if (config.simd && simd::hasAVX2()) {
+            i = solveAVX2(phi2, v, delta2, sigma, out, n, config);
+        }
+#endif
+        for (; i < n; ++i) {
+            out[i] = solveVolatility(phi2[i], v[i], delta2[i], sigma[i], config);
+        }
+    }
+
+    // Full Glicko-2 update of one player over the period's games.
+    static Glicko2Player update(const Glicko2Player& p, const std::vector<Glicko2Match>& games,
+                                const Config& config = Config()) {
+        double mu = (p.rating - 1500) / kScale;
+        double phi = p.RD / kScale;
+        if (games.empty()) {
+            Glicko2Player out = p;
+            out.RD = std::sqrt(phi * phi + p.volatility * p.volatility) * kScale;
+            return out;
+        }
+        double invV = 0, sum = 0;
+        for (const Glicko2Match& m : games) {
+            double mu_j = (m.opponent_rating - 1500) / kScale;
+            double phi_j = m.opponent_RD / kScale;
+            double gj = g(phi_j);
+            double e = E(mu, mu_j, phi_j);
+            invV += gj * gj * e * (1 - e);
+            sum += gj * (m.match_result - e);
+        }
+        double v = 1 / invV;
+        double delta = v * sum;
+        double sigma = solveVolatility(phi * phi, v, delta * delta, p.volatility, config);
+        return finish(mu, phi, sigma, v, sum);
+    }
+
+    // Steps 6-8: new phi and mu, back on the Glicko-1 scale.
+    static Glicko2Player finish(double mu, double phi, double sigma, double v, double sum) {
+        double phiStar = std::sqrt(phi * phi + sigma * sigma);
+        double phiNew = 1 / std::sqrt(1 / (phiStar * phiStar) + 1 / v);
+        Glicko2Player out;
+        out.rating = (mu + phiNew * phiNew * sum) * kScale + 1500;
+        out.RD = phiNew * kScale;
+        out.volatility = sigma;
+        return out;
+    }
+
+private:
+#if CHESS_RATING_X86_SIMD
+    __attribute__((target("avx2,fma")))
+    static __m256d fAVX2(__m256d x, __m256d phi2, __m256d v, __m256d delta2, __m256d a,
+                         __m256d tau2) {
+        __m256d ex = simd::expAVX2(x);
+        __m256d t = _mm256_add_pd(_mm256_add_pd(phi2, v), ex);
+        __m256d num = _mm256_mul_pd(ex, _mm256_sub_pd(_mm256_sub_pd(_mm256_sub_pd(delta2, phi2), v), ex));
+        __m256d den = _mm256_mul_pd(_mm256_set1_pd(2.0), _mm256_mul_pd(t, t));
+        return _mm256_sub_pd(_mm256_div_pd(num, den), _mm256_div_pd(_mm256_sub_pd(x, a), tau2));
+    }
+
+    __attribute__((target("avx2,fma")))
+    static size_t solveAVX2(const double* phi2, const double* v, const double* delta2,
+                            const double* sigma, double* out, size_t n, const Config& config) {
+        const __m256d tau2 = _mm256_set1_pd(config.tau * config.tau);
+        const __m256d eps = _mm256_set1_pd(config.epsilon);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            // Logs and brackets are computed once per lane before the loop.
+            double a[4], A[4], B[4];
+            for (int k = 0; k < 4; ++k) {
+                a[k] = std::log(sigma[i + k] * sigma[i + k]);
+                bracket(phi2[i + k], v[i + k], delta2[i + k], a[k], config.tau, A[k], B[k]);
+            }
+            __m256d vphi2 = _mm256_loadu_pd(phi2 + i);
+            __m256d vv = _mm256_loadu_pd(v + i);
+            __m256d vdelta2 = _mm256_loadu_pd(delta2 + i);
+            __m256d va = _mm256_loadu_pd(a);
+            __m256d vA = _mm256_loadu_pd(A);
+            __m256d vB = _mm256_loadu_pd(B);
+            __m256d fA = fAVX2(vA, vphi2, vv, vdelta2, va, tau2);
+            __m256d fB = fAVX2(vB, vphi2, vv, vdelta2, va, tau2);
+
+            __m256d active = _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(vB, vA), absMask), eps, _CMP_GT_OQ);
+            for (int it = 0; it < config.maxIterations && _mm256_movemask_pd(active); ++it) {
+                __m256d C = _mm256_add_pd(vA, _mm256_div_pd(_mm256_mul_pd(_mm256_sub_pd(vA, vB), fA),
+                                                            _mm256_sub_pd(fB, fA)));
+                // Finished lanes may produce NaN here; they are masked off below.
+                __m256d fC = fAVX2(C, vphi2, vv, vdelta2, va, tau2);
+                __m256d signChange = _mm256_cmp_pd(_mm256_mul_pd(fC, fB), _mm256_setzero_pd(), _CMP_LE_OQ);
+
+                __m256d nextA = _mm256_blendv_pd(vA, vB, signChange);
+                __m256d nextFA = _mm256_blendv_pd(_mm256_mul_pd(fA, half), fB, signChange);
+                vA = _mm256_blendv_pd(vA, nextA, active);
+                fA = _mm256_blendv_pd(fA, nextFA, active);
+                vB = _mm256_blendv_pd(vB, C, active);
+                fB = _mm256_blendv_pd(fB, fC, active);
+
+                active = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(vB, vA), absMask),
+                                                             eps, _CMP_GT_OQ));
+            }
+            _mm256_storeu_pd(out + i, simd::expAVX2(_mm256_mul_pd(vA, half)));
+        }
+        return i;
+    }
+#endif
+};
+
+// Population-wide Glicko-2 rating period over the same CSR game list as
+// RatingPeriodEngine. Sums run per player in parallel; the volatility solves
+// of all players with games are then batched through solveVolatilities.
+class Glicko2Engine {
+public:
+    std::vector<double> rating;
+    std::vector<double> RD;
+    std::vector<double> volatility;
+
+    Glicko2Engine(size_t players, double initialRating = 1500, double initialRD = 350,
+                  double initialVolatility = 0.06, Glicko2::Config config = Glicko2::Config())
+        : rating(players, initialRating), RD(players, initialRD),
+          volatility(players, initialVolatility), config(config) {}
+
+    size_t players() const { return rating.size(); }
+
+    void runPeriod(const PeriodGames& games) {
+        const size_t n = players();
+        if (games.players() != n) {
+            throw std::invalid_argument("Glicko2Engine: game list is for a different population");
+        }
+
+        // Compact list of players with games, in index order.
+        std::vector<uint32_t> active;
+        for (size_t i = 0; i < n; ++i) {
+            if (games.gamesOf(i) > 0) active.push_back(static_cast<uint32_t>(i));
+        }
+        const size_t m = active.size();
+        std::vector<double> phi2(m), v(m), delta2(m), sigma(m), sum(m), newSigma(m);
+
+        parallelFor(0, m, 1 << 10, [&](size_t lo, size_t hi, unsigned) {
+            for (size_t k = lo; k < hi; ++k) {
+                size_t i = active[k];
+                double mu = (rating[i] - 1500) / Glicko2::kScale;
+                double phi = RD[i] / Glicko2::kScale;
+                double invV = 0, s = 0;
+                for (size_t e = games.offsets[i]; e < games.offsets[i + 1]; ++e) {
+                    uint32_t j = games.opponents[e];
+                    double mu_j = (rating[j] - 1500) / Glicko2::kScale;
+                    double phi_j = RD[j] / Glicko2::kScale;
+                    double gj = Glicko2::g(phi_j);
+                    double ej = Glicko2::E(mu, mu_j, phi_j);
+                    invV += gj * gj * ej * (1 - ej);
+                    s += gj * (games.scores[e] - ej);
+                }
+                phi2[k] = phi * phi;
+                v[k] = 1 / invV;
+                delta2[k] = (v[k] * s) * (v[k] * s);
+                sigma[k] = volatility[i];
+                sum[k] = s;
+            }
+        }, config.threads);
+
+        // Blocks are multiples of the vector width so only the last one has a
+        // scalar tail.
+        parallelFor(0, (m + 255) / 256, 1, [&](size_t lo, size_t hi, unsigned) {
+            size_t b = lo * 256, e = std::min(hi * 256, m);
+            Glicko2::solveVolatilities(&phi2[b], &v[b], &delta2[b], &sigma[b], &newSigma[b], e - b, config);
+        }, config.threads);
+
+        std::vector<double> newRating(rating), newRD(n), newVol(volatility);
+        for (size_t i = 0; i < n; ++i) {
+            // Players who did not compete only gain uncertainty.
+            double phi = RD[i] / Glicko2::kScale;
+            newRD[i] = std::sqrt(phi * phi + volatility[i] * volatility[i]) * Glicko2::kScale;
+        }
+        parallelFor(0, m, 1 << 12, [&](size_t lo, size_t hi, unsigned) {
+            for (size_t k = lo; k < hi; ++k) {
+                size_t i = active[k];
+                double mu = (rating[i] - 1500) / Glicko2::kScale;
+                Glicko2Player p = Glicko2::finish(mu, std::sqrt(phi2[k]), newSigma[k], v[k], sum[k]);
+                newRating[i] = p.rating;
+                newRD[i] = p.RD;
+                newVol[i] = p.volatility;
+            }
+        }, config.threads);
+
+        rating.swap(newRating);
+        RD.swap(newRD);
+        volatility.swap(newVol);
+    }
+
+private:
+    Glicko2::Config config;
+};
+
+#endif // GLICKO2_H
@@ -0,0 +1,246 @@
+#ifndef GLICKO_TABLES_H
+#define GLICKO_TABLES_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+#include "Glicko.h"
+
+// Table-driven Glicko-1 kernel for integer inputs. Chess.com ratings and RDs
+// are ints, so g(RD_j) has at most kMaxRD + 1 distinct values and the exponent
+// of 10^(-g(RD_j)(r - r_j)/400) stays inside [-kMaxExp10, kMaxExp10] for
+// |r - r_j| <= kMaxRatingDiff. Both are generated at compile time; inputs
+// outside the tables fall back to glickoNewRating.
+
+enum class GlickoKernel { Exact, Table };
+
+namespace glicko_tables {
+
+const int kMaxRD = 500;
+const int kMaxRatingDiff = 1600;
+// 10^x = 10^(k/32) * 10^(j/1024) * 10^rho with |rho| <= 1/2048
+const int kCoarseSteps = 32;
+const int kFineSteps = 32;
+const int kMaxExp10 = 4;
+const int kCoarseHalf = kMaxExp10 * kCoarseSteps;
+constexpr long double kLn10 = 2.302585092994045684017991454684364208L;
+
+constexpr long double constSqrt(long double x) {
+    if (x <= 0) return 0;
+    long double y = x < 1 ? 1 : x;
+    for (int i = 0; i < 100; ++i) {
+        long double next = (y + x / y) / 2;
+        if (next == y) break;
+        y = next;
+    }
+    return y;
+}
+
+// e^x by Taylor series; only called with |x| <= ln(10).
+constexpr long double constExp(long double x) {
+    long double sum = 1, term = 1;
+    for (int n = 1; n < 60; ++n) {
+        term *= x / n;
+        sum += term;
+    }
+    return sum;
+}
+
+// 10^(num/den) as an exact power of ten times e^(frac * ln 10).
+constexpr long double constPow10(int num, int den) {
+    int whole = num / den;
+    int rest = num % den;
+    if (rest < 0) { rest += den; --whole; }
+    long double scale = 1;
+    for (int i = 0; i < (whole < 0 ? -whole : whole); ++i) scale *= 10;
+    if (whole < 0) scale = 1 / scale;
+    return scale * constExp(kLn10 * rest / den);
+}
+
+struct GTable { double v[kMaxRD + 1]; };
+struct CoarseTable { double v[2 * kCoarseHalf + 1]; };
+struct FineTable { double v[kFineSteps]; };
+
+constexpr GTable makeGTable() {
+    GTable t{};
+    const long double ql = 0.0057565L;
+    const long double pil = 3.14159265358979323846L;
+    for (int rd = 0; rd <= kMaxRD; ++rd) {
+        t.v[rd] = static_cast<double>(1 / constSqrt(1 + 3 * ql * ql * rd * rd / (pil * pil)));
+    }
+    return t;
+}
+
+constexpr CoarseTable makeCoarseTable() {
+    CoarseTable t{};
+    for (int k = -kCoarseHalf; k <= kCoarseHalf; ++k) {
+        t.v[k + kCoarseHalf] = static_cast<double>(constPow10(k, kCoarseSteps));
+    }
+    return t;
+}
+
+constexpr FineTable makeFineTable() {
+    FineTable t{};
+    for (int j = 0; j < kFineSteps; ++j) {
+        t.v[j] = static_cast<double>(constPow10(j, kCoarseSteps * kFineSteps));
+    }
+    return t;
+}
+
+constexpr GTable kG = makeGTable();
+constexpr CoarseTable kCoarse = makeCoarseTable();
+constexpr FineTable kFine = makeFineTable();
+
+} // namespace glicko_tables
+
+class GlickoTables {
+public:
+    // Whether the table kernel can score this pairing.
+    static bool covers(double r, double RD, double r_j, double RD_j) {
+        using namespace glicko_tables;
+        return isInt(r) && isInt(RD) && isInt(r_j) && isInt(RD_j) &&
+               RD >= 1 && RD <= kMaxRD && RD_j >= 0 && RD_j <= kMaxRD &&
+               std::abs(r - r_j) <= kMaxRatingDiff;
+    }
+
+    static double g(int RD_j) {
+        return glicko_tables::kG.v[RD_j];
+    }
+
+    // 10^x for |x| <= kMaxExp10: two table lookups and a quartic for the
+    // residual (|rho * ln 10| <= 1.2e-3, truncation error below 2e-17).
+    static double pow10(double x) {
+        using namespace glicko_tables;
+        const int steps = kCoarseSteps * kFineSteps;
+        int n = static_cast<int>(std::floor(x * steps + 0.5));
+        double rho = (x - static_cast<double>(n) / steps) * static_cast<double>(kLn10);
+        int j = n & (kFineSteps - 1);
+        int k = (n - j) / kFineSteps;
+        double tail = 1 + rho * (1 + rho * (0.5 + rho * (1.0 / 6 + rho * (1.0 / 24))));
+        return kCoarse.v[k + kCoarseHalf] * kFine.v[j] * tail;
+    }
+
+    static GlickoTerms terms(int r, int RD, int r_j, int RD_j) {
+        GlickoTerms t;
+        t.r = r;
+        t.gRD_j = g(RD_j);
+        t.E = 1 / (1 + pow10(-t.gRD_j * (r - r_j) / 400));
+        double sum = t.gRD_j * t.gRD_j * t.E * (1 - t.E);
+        t.denom = 1.0 / (static_cast<double>(RD) * RD) + q * q * sum;
+        return t;
+    }
+
+    static double calculate_new_rating(int r, int RD, int r_j, int RD_j, double s) {
+        return terms(r, RD, r_j, RD_j).newRating(s);
+    }
+
+    static RatingOutcomes outcomes(int r, int RD, int r_j, int RD_j) {
+        GlickoTerms t = terms(r, RD, r_j, RD_j);
+        RatingOutcomes out;
+        out.win = t.newRating(1);
+        out.lose = t.newRating(0);
+        out.draw = t.newRating(0.5);
+        out.newRD = t.newRD();
+        return out;
+    }
+
+    struct AccuracyReport {
+        size_t samples;
+        double maxAbsError;  // rating points
+        double meanAbsError;
+        int worstR, worstRD, worstRj, worstRDj;
+    };
+
+    // Compares the table kernel with glickoNewRating over an integer grid:
+    // r fixed at 1500, r_j over the full rating-difference range, RD and RD_j
+    // over [55, kMaxRD] (the calculateRatingRes floor) in steps of rdStep.
+    static AccuracyReport accuracyReport(int rdStep = 5, int diffStep = 1) {
+        using namespace glicko_tables;
+        AccuracyReport rep = {0, 0, 0, 0, 0, 0, 0};
+        double total = 0;
+        const int r = 1500;
+        for (int RD = 55; RD <= kMaxRD; RD += rdStep) {
+            for (int RD_j = 55; RD_j <= kMaxRD; RD_j += rdStep) {
+                for (int r_j = r - kMaxRatingDiff; r_j <= r + kMaxRatingDiff; r_j += diffStep) {
+                    GlickoTerms t = terms(r, RD, r_j, RD_j);
+                    for (double s = 0; s <= 1; s += 0.5) {
+                        double err = std::abs(t.newRating(s) - glickoNewRating(r, RD, r_j, RD_j, s));
+                        total += err;
+                        ++rep.samples;
+                        if (err > rep.maxAbsError) {
+                            rep.maxAbsError = err;
+                            rep.worstR = r;
+                            rep.worstRD = RD;
+                            rep.worstRj = r_j;
+                            rep.worstRDj = RD_j;
+                        }
+                    }
+                }
+            }
+        }
+        rep.meanAbsError = rep.samples ? total / rep.samples : 0;
+        return rep;
+    }
+
+    struct SpeedReport {
+        size_t pairings;
+        double exactSeconds; // glickoNewRating
+        double tableSeconds; // calculate_new_rating
+        double speedup;      // exactSeconds / tableSeconds
+        double maxAbsError;
+    };
+
+    // Times the table kernel against glickoNewRating on the same `n` integer
+    // pairings (ratings 800-2800 within kMaxRatingDiff of each other, RDs
+    // 55-350), each run `rounds` times.
+    static SpeedReport benchmark(size_t n = 1 << 18, int rounds = 10) {
+        struct Input { int r, RD, r_j, RD_j; double s; };
+        std::vector<Input> inputs(n);
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> rating(800, 2800), dev(55, 350), score(0, 2);
+        for (Input& in : inputs) {
+            in.r = rating(rng);
+            in.r_j = std::min(std::max(rating(rng), in.r - glicko_tables::kMaxRatingDiff),
+                              in.r + glicko_tables::kMaxRatingDiff);
+            in.RD = dev(rng);
+            in.RD_j = dev(rng);
+            in.s = score(rng) / 2.0;
+        }
+
+        std::vector<double> exact(n), table(n);
+        auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < rounds; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                const Input& in = inputs[i];
+                exact[i] = glickoNewRating(in.r, in.RD, in.r_j, in.RD_j, in.s);
+            }
+        }
+        auto middle = std::chrono::steady_clock::now();
+        for (int k = 0; k < rounds; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                const Input& in = inputs[i];
+                table[i] = calculate_new_rating(in.r, in.RD, in.r_j, in.RD_j, in.s);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        SpeedReport rep;
+        rep.pairings = n * static_cast<size_t>(std::max(rounds, 0));
+        rep.exactSeconds = std::chrono::duration<double>(middle - start).count();
+        rep.tableSeconds = std::chrono::duration<double>(end - middle).count();
+        rep.speedup = rep.tableSeconds > 0 ? rep.exactSeconds / rep.tableSeconds : 0;
+        rep.maxAbsError = 0;
+        for (size_t i = 0; i < n; ++i) rep.maxAbsError = std::max(rep.maxAbsError, std::abs(exact[i] - table[i]));
+        return rep;
+    }
+
+private:
+    static bool isInt(double x) {
+        return x == std::floor(x);
+    }
+};
+
+#endif // GLICKO_TABLES_H
@@ -0,0 +1,229 @@
+#ifndef INCREMENTAL_RATINGS_H
+#define INCREMENTAL_RATINGS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "Glicko.h"
+#include "ParallelFor.h"
+#include "RatingPeriodEngine.h"
+
+// Glicko-1 rating history that absorbs late or corrected games without a full
+// replay. It gives the same results as running RatingPeriodEngine over every
+// period in order.
+//
+// Each player keeps one snapshot (rating and RD after the period) per period
+// in which they played. Idle periods only grow the RD, so the onset state of
+// any period follows in closed form from the latest earlier snapshot:
+// RD = min(sqrt(RD^2 + c^2 t), maxRD). When a game in period p changes, only
+// its two players are recomputed at p. A player whose snapshot changes makes
+// their next played period dirty, for themselves and for everyone they met
+// there, and so on forward. The work is proportional to that downstream cone,
+// not to the archive.
+class IncrementalRatings {
+public:
+    typedef RatingPeriodEngine::Config Config;
+
+    struct State {
+        double rating;
+        double RD;
+    };
+
+    IncrementalRatings(size_t players, double initialRating = 1500, double initialRD = 350,
+                       Config config = Config())
+        : history(players), initial{initialRating, initialRD}, config(config), recomputed(0) {}
+
+    size_t players() const { return history.size(); }
+    size_t periods() const { return games.size(); }
+
+    // Adds games to `period` (which may be in the past) and updates every
+    // rating that depends on them.
+    void addGames(uint32_t period, const std::vector<PeriodGame>& added) {
+        ensurePeriod(period);
+        Dirty dirty;
+        for (const PeriodGame& g : added) {
+            checkPlayers(g);
+            games[period][g.white].push_back(Edge{g.black, g.score});
+            games[period][g.black].push_back(Edge{g.white, 1.0f - g.score});
+            dirty[period].push_back(g.white);
+            dirty[period].push_back(g.black);
+        }
+        propagate(dirty);
+    }
+
+    void addGame(uint32_t period, const PeriodGame& game) {
+        addGames(period, std::vector<PeriodGame>(1, game));
+    }
+
+    // Removes one previously added game (matched on players and score).
+    void removeGame(uint32_t period, const PeriodGame& game) {
+        checkPlayers(game);
+        if (period >= games.size() || !eraseEdge(period, game.white, game.black, game.score) ||
+            !eraseEdge(period, game.black, game.white, 1.0f - game.score)) {
+            throw std::invalid_argument("IncrementalRatings: game not found");
+        }
+        Dirty dirty;
+        dirty[period].push_back(game.white);
+        dirty[period].push_back(game.black);
+        propagate(dirty);
+    }
+
+    // Replaces the result of a recorded game.
+    void correctGame(uint32_t period, const PeriodGame& game, float newScore) {
+        checkPlayers(game);
+        if (period >= games.size() || !eraseEdge(period, game.white, game.black, game.score) ||
+            !eraseEdge(period, game.black, game.white, 1.0f - game.score)) {
+            throw std::invalid_argument("IncrementalRatings: game not found");
+        }
+        PeriodGame fixed = game;
+        fixed.score = newScore;
+        addGames(period, std::vector<PeriodGame>(1, fixed));
+    }
+
+    // Rating and RD at the onset of `period`, before its games.
+    State onset(uint32_t player, uint32_t period) const {
+        const std::vector<Snapshot>& h = history[player];
+        auto it = std::lower_bound(h.begin(), h.end(), period,
+                                   [](const Snapshot& s, uint32_t p) { return s.period < p; });
+        if (it == h.begin()) {
+            return decay(initial, static_cast<double>(period) + 1);
+        }
+        --it;
+        return decay(it->state, static_cast<double>(period - it->period));
+    }
+
+    // Rating and RD after the last known period, matching RatingPeriodEngine
+    // after the same number of runPeriod calls.
+    State current(uint32_t player) const {
+        if (games.empty()) return initial;
+        if (games.back().count(player)) return history[player].back().state;
+        // Idle in the last period: its onset state is also its final state.
+        return onset(player, static_cast<uint32_t>(games.size() - 1));
+    }
+
+    // (player, period) updates done by the last add/remove/correct call.
+    size_t lastRecomputed() const { return recomputed; }
+
+private:
+    struct Edge {
+        uint32_t opponent;
+        float score;
+    };
+    struct Snapshot {
+        uint32_t period;
+        State state; // after the period
+    };
+    typedef std::map<uint32_t, std::vector<uint32_t>> Dirty;
+
+    std::vector<std::unordered_map<uint32_t, std::vector<Edge>>> games; // per period, per player
+    std::vector<std::vector<Snapshot>> history;                        // per player, by period
+    State initial; // treated as the state after period -1
+    Config config;
+    size_t recomputed;
+
+    State decay(State s, double t) const {
+        s.RD = std::min(std::sqrt(s.RD * s.RD + config.c * config.c * t), config.maxRD);
+        return s;
+    }
+
+    void ensurePeriod(uint32_t period) {
+        if (period >= games.size()) games.resize(static_cast<size_t>(period) + 1);
+    }
+
+    void checkPlayers(const PeriodGame& g) const {
+        if (g.white >= players() || g.black >= players()) {
+            throw std::out_of_range("IncrementalRatings: player index out of range");
+        }
+    }
+
+    bool eraseEdge(uint32_t period, uint32_t player, uint32_t opponent, float score) {
+        auto it = games[period].find(player);
+        if (it == games[period].end()) return false;
+        std::vector<Edge>& edges = it->second;
+        for (size_t k = 0; k < edges.size(); ++k) {
+            if (edges[k].opponent == opponent && edges[k].score == score) {
+                edges.erase(edges.begin() + k);
+                if (edges.empty()) games[period].erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void propagate(Dirty& dirty) {
+        recomputed = 0;
+        while (!dirty.empty()) {
+            uint32_t period = dirty.begin()->first;
+            std::vector<uint32_t> batch;
+            batch.swap(dirty.begin()->second);
+            dirty.erase(dirty.begin());
+            std::sort(batch.begin(), batch.end());
+            batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+            recomputed += batch.size();
+
+            // Step 2 for every dirty player reads only snapshots of earlier
+            // periods, so the batch is computed in parallel and committed after.
+            std::vector<State> next(batch.size());
+            std::vector<char> played(batch.size(), 0);
+            const auto& periodGames = games[period];
+            parallelFor(0, batch.size(), 64, [&](size_t lo, size_t hi, unsigned) {
+                for (size_t k = lo; k < hi; ++k) {
+                    auto it = periodGames.find(batch[k]);
+                    if (it == periodGames.end()) continue;
+                    State self = onset(batch[k], period);
+                    GlickoPeriodSums sums;
+                    for (const Edge& e : it->second) {
+                        State opp = onset(e.opponent, period);
+                        sums.add(self.rating, opp.rating, opp.RD, e.score);
+                    }
+                    sums.finish(self.rating, self.RD, config.minRD, next[k].rating, next[k].RD);
+                    played[k] = 1;
+                }
+            }, config.threads);
+
+            for (size_t k = 0; k < batch.size(); ++k) {
+                uint32_t player = batch[k];
+                if (!commit(player, period, played[k] != 0, next[k])) continue;
+
+                // The player's onset changed for every later period up to and
+                // including the next one they played in.
+                const std::vector<Snapshot>& h = history[player];
+                auto later = std::upper_bound(h.begin(), h.end(), period,
+                                              [](uint32_t p, const Snapshot& s) { return p < s.period; });
+                if (later == h.end()) continue;
+                std::vector<uint32_t>& d = dirty[later->period];
+                d.push_back(player);
+                for (const Edge& e : games[later->period].at(player)) {
+                    d.push_back(e.opponent);
+                }
+            }
+        }
+    }
+
+    // Stores the player's post-period state; returns whether it changed.
+    bool commit(uint32_t player, uint32_t period, bool played, const State& state) {
+        std::vector<Snapshot>& h = history[player];
+        auto it = std::lower_bound(h.begin(), h.end(), period,
+                                   [](const Snapshot& s, uint32_t p) { return s.period < p; });
+        bool exists = it != h.end() && it->period == period;
+        if (!played) {
+            if (!exists) return false;
+            h.erase(it);
+            return true;
+        }
+        if (exists) {
+            if (it->state.rating == state.rating && it->state.RD == state.RD) return false;
+            it->state = state;
+            return true;
+        }
+        h.insert(it, Snapshot{period, state});
+        return true;
+    }
+};
+
+#endif // INCREMENTAL_RATINGS_H
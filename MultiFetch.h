@@ -0,0 +1,206 @@
+#ifndef MULTI_FETCH_H
+#define MULTI_FETCH_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+#include "CurlPool.h"
+
+// Shared curl_multi loop for concurrent GETs. One thread drives every
+// transfer, so they share the multi handle's connection cache: requests to
+// the same host are multiplexed over one HTTP/2 connection when the server
+// allows it, otherwise they open parallel connections. Easy handles come
+// from CurlPool and get its options and DNS/TLS caches.
+//
+// get() has the shape of RequestScheduler::Fetch: the caller blocks until its
+// transfer finishes, while the loop carries the others. Any number of
+// callers can wait at once, so concurrency is bounded by how many requests
+// are started (the scheduler's workers and token bucket), not by connections.
+class MultiFetch {
+public:
+    typedef CurlPool::Response Response;
+
+    static const long kPollMillis = 50; // longest wait before `abort` is checked
+
+    static MultiFetch& instance() {
+        static MultiFetch fetch;
+        return fetch;
+    }
+
+    MultiFetch(const MultiFetch&) = delete;
+    MultiFetch& operator=(const MultiFetch&) = delete;
+
+    // Blocking GET on the loop. Throws std::runtime_error if the transfer
+    // fails and "Cancelled" once `abort` returns true; `abort` is called from
+    // the loop thread. HTTP error statuses are returned, not thrown.
+    Response get(const std::string& url, const std::function<bool()>& abort = std::function<bool()>()) {
+        Transfer transfer(url, abort);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) throw std::runtime_error("MultiFetch stopped");
+            incoming.push_back(&transfer);
+        }
+        curl_multi_wakeup(multi);
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&transfer]() { return transfer.done; });
+        if (!transfer.error.empty()) throw std::runtime_error(transfer.error);
+        return transfer.response;
+    }
+
+    // Transfers on the loop right now.
+    size_t active() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return running;
+    }
+
+private:
+    struct Transfer {
+        std::string url;
+        std::function<bool()> abort;
+        CurlPool::Handle* handle;
+        std::chrono::steady_clock::time_point start;
+        Response response;
+        std::string error;
+        bool done;
+
+        Transfer(const std::string& url, const std::function<bool()>& abort)
+            : url(url), abort(abort), handle(nullptr), response(), done(false) {}
+    };
+
+    CurlPool& pool;
+    CURLM* multi;
+    mutable std::mutex mutex;
+    std::condition_variable finished;
+    std::deque<Transfer*> incoming;
+    size_t running;
+    bool stopping;
+    std::thread loop; // last, so it starts after the members it uses
+
+    // The pool is constructed first so that it outlives a static MultiFetch.
+    MultiFetch() : pool(CurlPool::instance()), multi(curl_multi_init()), running(0), stopping(false) {
+        if (!multi) throw std::runtime_error("MultiFetch: curl_multi_init failed");
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        loop = std::thread([this]() { run(); });
+    }
+
+    ~MultiFetch() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        curl_multi_wakeup(multi);
+        loop.join();
+        curl_multi_cleanup(multi);
+    }
+
+    void start(Transfer* t) {
+        t->handle = new CurlPool::Handle(pool.acquire());
+        CURL* curl = t->handle->get();
+        curl_easy_setopt(curl, CURLOPT_URL, t->url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &t->response.body);
+        curl_easy_setopt(curl, CURLOPT_PRIVATE, t);
+        // Wait for a connection still being set up that may multiplex rather
+        // than open another; against an HTTP/1.1 server that costs the first
+        // batch one round trip.
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        t->start = std::chrono::steady_clock::now();
+        curl_multi_add_handle(multi, curl);
+    }
+
+    // Takes the transfer off the loop and wakes its caller. An empty `error`
+    // reads the response out of the handle.
+    void finish(Transfer* t, const std::string& error, std::vector<Transfer*>& live) {
+        CURL* curl = t->handle->get();
+        curl_multi_remove_handle(multi, curl);
+        t->response.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t->start).count();
+        if (error.empty()) {
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &t->response.status);
+            curl_off_t retryAfter = 0;
+            curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter);
+            t->response.retryAfter = static_cast<double>(retryAfter);
+        }
+        delete t->handle;
+        t->handle = nullptr;
+        for (size_t i = 0; i < live.size(); ++i) {
+            if (live[i] == t) {
+                live[i] = live.back();
+                live.pop_back();
+                break;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        t->error = error;
+        t->done = true;
+        running = live.size();
+        finished.notify_all();
+    }
+
+    void run() {
+        std::vector<Transfer*> live;
+        for (;;) {
+            std::deque<Transfer*> added;
+            bool stop;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                added.swap(incoming);
+                stop = stopping;
+                running = live.size() + added.size();
+            }
+            if (stop) {
+                for (Transfer* t : added) live.push_back(t);
+                while (!live.empty()) {
+                    Transfer* t = live.back();
+                    if (t->handle) {
+                        finish(t, "MultiFetch stopped", live);
+                    } else {
+                        live.pop_back();
+                        std::lock_guard<std::mutex> lock(mutex);
+                        t->error = "MultiFetch stopped";
+                        t->done = true;
+                        finished.notify_all();
+                    }
+                }
+                return;
+            }
+            for (Transfer* t : added) {
+                try {
+                    start(t);
+                    live.push_back(t);
+                } catch (const std::exception& ex) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    t->error = ex.what();
+                    t->done = true;
+                    finished.notify_all();
+                }
+            }
+
+            int stillRunning = 0;
+            curl_multi_perform(multi, &stillRunning);
+            int queued = 0;
+            while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+                if (msg->msg != CURLMSG_DONE) continue;
+                Transfer* t = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char**>(&t));
+                const CURLcode res = msg->data.result;
+                finish(t, res == CURLE_OK ? std::string()
+                                          : std::string("Failed to fetch data from Chess.com API: ") +
+                                                curl_easy_strerror(res),
+                       live);
+            }
+            for (size_t i = live.size(); i-- > 0;) {
+                if (i < live.size() && live[i]->abort && live[i]->abort()) finish(live[i], "Cancelled", live);
+            }
+            curl_multi_poll(multi, nullptr, 0, live.empty() ? 1000 : kPollMillis, nullptr);
+        }
+    }
+};
+
+#endif // MULTI_FETCH_H
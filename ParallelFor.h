@@ -0,0 +1,117 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of workers to use when the caller passes 0.
+inline unsigned workerCount(unsigned requested = 0) {
+    if (requested > 0) return requested;
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+// Runs fn(lo, hi, worker) over [begin, end) on `threads` workers.
+//
+// Each worker starts with an equal contiguous slice and takes `grain` items at
+// a time from its front. A worker that runs dry steals the back half of the
+// largest remaining slice, so uneven rows (players with many games, grid rows
+// that exit early) still keep every core busy. `worker` is in [0, threads)
+// and can index per-thread scratch or accumulators. The first exception
+// thrown by fn is rethrown on the calling thread.
+template <class F>
+void parallelFor(size_t begin, size_t end, size_t grain, F fn, unsigned threads = 0) {
+    if (end <= begin) return;
+    size_t n = end - begin;
+    if (grain == 0) grain = 1;
+    threads = workerCount(threads);
+    threads = static_cast<unsigned>(std::min<size_t>(threads, (n + grain - 1) / grain));
+    if (threads <= 1) {
+        for (size_t lo = begin; lo < end; lo += grain) {
+            fn(lo, std::min(lo + grain, end), 0u);
+        }
+        return;
+    }
+
+    struct Slice {
+        std::mutex m;
+        size_t lo, hi;
+        char pad[64]; // keep neighbouring slices off the same cache line
+    };
+    std::vector<Slice> slices(threads);
+    for (unsigned w = 0; w < threads; ++w) {
+        slices[w].lo = begin + n * w / threads;
+        slices[w].hi = begin + n * (w + 1) / threads;
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto worker = [&](unsigned self) {
+        try {
+            for (;;) {
+                size_t lo = 0, hi = 0;
+                {
+                    std::lock_guard<std::mutex> lock(slices[self].m);
+                    if (slices[self].lo < slices[self].hi) {
+                        lo = slices[self].lo;
+                        hi = std::min(lo + grain, slices[self].hi);
+                        slices[self].lo = hi;
+                    }
+                }
+                if (lo < hi) {
+                    fn(lo, hi, self);
+                    continue;
+                }
+
+                // Steal the back half of the biggest slice still pending.
+                unsigned victim = threads;
+                size_t most = 0;
+                for (unsigned v = 0; v < threads; ++v) {
+                    if (v == self) continue;
+                    std::lock_guard<std::mutex> lock(slices[v].m);
+                    size_t left = slices[v].hi - slices[v].lo;
+                    if (left > most) {
+                        most = left;
+                        victim = v;
+                    }
+                }
+                if (victim == threads) return;
+
+                size_t stolenLo = 0, stolenHi = 0;
+                {
+                    std::lock_guard<std::mutex> lock(slices[victim].m);
+                    size_t left = slices[victim].hi - slices[victim].lo;
+                    if (left == 0) continue;
+                    size_t take = left > grain ? left / 2 : left;
+                    stolenHi = slices[victim].hi;
+                    stolenLo = stolenHi - take;
+                    slices[victim].hi = stolenLo;
+                }
+                std::lock_guard<std::mutex> lock(slices[self].m);
+                slices[self].lo = stolenLo;
+                slices[self].hi = stolenHi;
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned w = 1; w < threads; ++w) {
+        pool.emplace_back(worker, w);
+    }
+    worker(0);
+    for (auto& t : pool) {
+        t.join();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+#endif // PARALLEL_FOR_H
@@ -0,0 +1,473 @@
+#ifndef PARAMETER_SWEEP_H
+#define PARAMETER_SWEEP_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "GameStore.h"
+#include "Glicko.h"
+#include "ParallelFor.h"
+#include "PolicyBacktest.h"
+#include "RiskModel.h"
+#include "SessionSimulator.h"
+#include "StatsExtractor.h"
+
+// Sweeps the analyzeRisk thresholds (RiskParams and the abort prior) over a
+// grid and reports the Pareto frontier of mean session gain against
+// downside risk.
+//
+// The pairings are prepared once, either from stored history with the
+// sessions, allowances and rating estimates of PolicyBacktest, or from the
+// pairings SessionSimulator draws. For each one the Glicko outcomes and the
+// parameter-free part of riskTerms (RiskInputs) are precomputed, so a
+// parameter point only costs decideRisk and the abort bookkeeping.
+//
+// Sharing the pairings means every point sees them at the rating the player
+// actually had (open loop): a played game moves the rating as it did, an
+// abort within the allowance removes the game's change, and an abort beyond
+// it costs the forfeit loss instead. The gain of a session is the sum of
+// these differences against playing every game. Ratings drifting apart
+// within a session are ignored. PolicyBacktest or SessionSimulator with
+// AnalyzeRiskPolicy{params} replays a chosen point in closed loop.
+//
+// Points are spread over parallelFor's workers and every point is evaluated
+// on its own, so results do not depend on the thread count. With
+// refineLevels > 0 the neighbours of every frontier point are evaluated at
+// half the grid spacing, once per level, and the frontier is recomputed.
+class ParameterSweep {
+public:
+    struct Point {
+        RiskParams params;
+        int minAborts; // abort prior of AbortBelief
+        int maxAborts;
+
+        Point() : minAborts(5), maxAborts(10) {}
+    };
+
+    // Cartesian grid; the defaults bracket the current thresholds.
+    struct Grid {
+        std::vector<double> scalingNumerator;
+        std::vector<double> minGain;
+        std::vector<double> maxLoss;
+        std::vector<double> riskRewardCutoff;
+        std::vector<std::pair<int, int>> abortPriors;
+
+        Grid()
+            : scalingNumerator({150, 200, 250, 300, 350}), minGain({0, 2.5, 5, 7.5, 10}),
+              maxLoss({-20, -15, -10, -5}), riskRewardCutoff({0.5, 0.75, 1.0, 1.5, 2.0}),
+              abortPriors({{3, 8}, {5, 10}, {8, 13}}) {}
+
+        std::vector<Point> points() const {
+            std::vector<Point> out;
+            for (double s : scalingNumerator)
+                for (double g : minGain)
+                    for (double l : maxLoss)
+                        for (double r : riskRewardCutoff)
+                            for (const std::pair<int, int>& prior : abortPriors) {
+                                Point p;
+                                p.params.scalingNumerator = s;
+                                p.params.minGain = g;
+                                p.params.maxLoss = l;
+                                p.params.riskRewardCutoff = r;
+                                p.minAborts = prior.first;
+                                p.maxAborts = prior.second;
+                                out.push_back(p);
+                            }
+            return out;
+        }
+    };
+
+    // Pairings shared by every point, grouped into sessions.
+    struct Pairings {
+        std::vector<RiskInputs> inputs;
+        std::vector<double> playedChange; // rating change of the game as played
+        std::vector<size_t> sessionStart; // one more than sessions()
+        std::vector<int> allowance;       // aborts the site grants the session
+        double seconds;
+
+        Pairings() : sessionStart(1, 0), seconds(0) {}
+
+        size_t size() const { return inputs.size(); }
+        size_t sessions() const { return allowance.size(); }
+    };
+
+    struct Config {
+        double tail;      // downside risk: mean gain of the worst `tail` share of sessions
+        int refineLevels;
+        unsigned threads; // 0 = all cores
+
+        Config() : tail(0.05), refineLevels(0), threads(0) {}
+    };
+
+    struct Result {
+        Point point;
+        size_t played;
+        size_t aborts;
+        size_t forfeits;
+        double meanGain;  // per session
+        double stddevGain;
+        double p5;
+        double tailMean;  // the downside measure of the frontier
+        double worseSessions;
+    };
+
+    struct Report {
+        size_t sessions;
+        size_t pairings;
+        std::vector<Result> results;
+        std::vector<size_t> frontier; // indices into results, by falling mean gain
+        double seconds;
+    };
+
+    // Pairings from stored history. Sessions, allowances and the rating and
+    // RD estimates follow PolicyBacktest with the same config, along the
+    // actual rating path.
+    //
+    // The store is streamed in blocks of config.blockRows with rows grouped
+    // by player, as in PolicyBacktest. Each player and mode holds only its
+    // open session; sessions closed within a block are appended in player
+    // order after it, and those still open at the end in player and mode
+    // order. Memory is the result plus about one block and the open sessions.
+    static Pairings fromStore(const GameStore& store,
+                              const PolicyBacktest::Config& config = PolicyBacktest::Config()) {
+        auto start = std::chrono::steady_clock::now();
+        if (config.minAborts > config.maxAborts || config.sessionGap <= 0 || config.blockRows == 0) {
+            throw std::invalid_argument("ParameterSweep: invalid backtest configuration");
+        }
+        const unsigned threads = workerCount(config.threads);
+        std::vector<Track> tracks(store.players() * PlayerStats::kModes);
+
+        Pairings out;
+        std::vector<Sessions> closed;
+        GameStore::Columns block;
+        std::vector<uint32_t> order;
+        std::vector<size_t> groups;
+        for (size_t first = 0; first < store.rows(); first += config.blockRows) {
+            store.read(first, config.blockRows, block);
+            const size_t n = block.size();
+            order.resize(n);
+            std::iota(order.begin(), order.end(), 0u);
+            std::stable_sort(order.begin(), order.end(),
+                             [&](uint32_t a, uint32_t b) { return block.player[a] < block.player[b]; });
+            groups.clear();
+            for (size_t i = 0; i < n; ++i) {
+                if (i == 0 || block.player[order[i]] != block.player[order[i - 1]]) groups.push_back(i);
+            }
+            groups.push_back(n);
+
+            closed.resize(groups.size() - 1);
+            parallelFor(0, groups.size() - 1, 1, [&](size_t lo, size_t hi, unsigned) {
+                for (size_t g = lo; g < hi; ++g) {
+                    for (size_t k = groups[g]; k < groups[g + 1]; ++k) {
+                        price(config, block, order[k], tracks, closed[g]);
+                    }
+                }
+            }, threads);
+            for (size_t g = 0; g + 1 < groups.size(); ++g) closed[g].moveTo(out);
+        }
+        Sessions rest;
+        for (Track& t : tracks) t.close(rest);
+        rest.moveTo(out);
+        out.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return out;
+    }
+
+    // Pairings drawn as SessionSimulator draws them for its sessions, all at
+    // the starting rating, with the result every game would have had if
+    // played.
+    static Pairings fromSimulator(size_t sessions,
+                                  const SessionSimulator::Config& config = SessionSimulator::Config()) {
+        auto start = std::chrono::steady_clock::now();
+        if (config.pairingsPerSession <= 0 || config.minAborts > config.maxAborts) {
+            throw std::invalid_argument("ParameterSweep: invalid session configuration");
+        }
+        const size_t per = static_cast<size_t>(config.pairingsPerSession);
+        const double rating = config.playerRating;
+        const double trueRating = std::isnan(config.trueRating) ? rating : config.trueRating;
+        const double RD = std::max(config.playerRD, kChessComRDFloor);
+
+        Pairings out;
+        out.inputs.resize(sessions * per);
+        out.playedChange.resize(sessions * per);
+        out.allowance.resize(sessions);
+        out.sessionStart.resize(sessions + 1);
+        parallelFor(0, sessions, 256, [&](size_t lo, size_t hi, unsigned) {
+            for (size_t s = lo; s < hi; ++s) {
+                SplitMix64 rng = SplitMix64::forStream(config.seed, s);
+                out.allowance[s] = rng.range(config.minAborts, config.maxAborts);
+                out.sessionStart[s + 1] = (s + 1) * per;
+                for (size_t k = s * per; k < (s + 1) * per; ++k) {
+                    double oppRating = std::round(rating + config.oppMeanOffset + config.oppSpread * rng.normal());
+                    double oppRD = std::max(
+                        std::round(config.oppRDMin + (config.oppRDMax - config.oppRDMin) * rng.uniform()),
+                        kChessComRDFloor);
+                    RatingOutcomes o = glickoOutcomes(rating, RD, oppRating, oppRD);
+                    out.inputs[k] = riskInputs(rating, oppRating, o.win, o.lose, o.draw, RD, oppRD);
+
+                    double u = rng.uniform(), pWin, pDraw, pLose;
+                    SessionSimulator::resultProbabilities(trueRating, oppRating, config.drawRate, pWin, pDraw,
+                                                          pLose);
+                    out.playedChange[k] = (u < pWin ? o.win : u < pWin + pDraw ? o.draw : o.lose) - rating;
+                }
+            }
+        }, workerCount(config.threads));
+        out.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return out;
+    }
+
+    // One point.
+    static Result evaluate(const Pairings& pairings, const Point& point, double tail = 0.05) {
+        std::vector<double> gains;
+        return evaluate(pairings, point, tail, gains);
+    }
+
+    static Report run(const Pairings& pairings, const Grid& grid = Grid(), const Config& config = Config()) {
+        auto start = std::chrono::steady_clock::now();
+        if (!(config.tail > 0 && config.tail <= 1)) {
+            throw std::invalid_argument("ParameterSweep: tail must be in (0, 1]");
+        }
+        const unsigned threads = workerCount(config.threads);
+        std::vector<std::vector<double>> scratch(threads);
+
+        Report report;
+        report.sessions = pairings.sessions();
+        report.pairings = pairings.size();
+        std::set<Key> seen;
+        std::vector<Point> pending;
+        for (const Point& p : grid.points()) {
+            if (seen.insert(key(p)).second) pending.push_back(p);
+        }
+        double steps[4] = {spacing(grid.scalingNumerator), spacing(grid.minGain), spacing(grid.maxLoss),
+                           spacing(grid.riskRewardCutoff)};
+
+        for (int level = 0;; ++level) {
+            const size_t first = report.results.size();
+            report.results.resize(first + pending.size());
+            parallelFor(0, pending.size(), 1, [&](size_t lo, size_t hi, unsigned worker) {
+                for (size_t i = lo; i < hi; ++i) {
+                    report.results[first + i] = evaluate(pairings, pending[i], config.tail, scratch[worker]);
+                }
+            }, threads);
+            report.frontier = frontier(report.results);
+            if (level == config.refineLevels) break;
+
+            pending.clear();
+            for (double& s : steps) s /= 2;
+            for (size_t f : report.frontier) {
+                for (int d = 0; d < 4; ++d) {
+                    if (steps[d] <= 0) continue;
+                    for (int sign = -1; sign <= 1; sign += 2) {
+                        Point p = report.results[f].point;
+                        double* value[4] = {&p.params.scalingNumerator, &p.params.minGain, &p.params.maxLoss,
+                                            &p.params.riskRewardCutoff};
+                        *value[d] += sign * steps[d];
+                        if (p.params.scalingNumerator <= 0) continue;
+                        if (seen.insert(key(p)).second) pending.push_back(p);
+                    }
+                }
+            }
+            if (pending.empty()) break;
+        }
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+    // Points no other point beats on both mean gain and tail mean, by
+    // falling mean gain. Ties keep the earlier point.
+    static std::vector<size_t> frontier(const std::vector<Result>& results) {
+        std::vector<size_t> order(results.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            if (results[a].meanGain != results[b].meanGain) return results[a].meanGain > results[b].meanGain;
+            if (results[a].tailMean != results[b].tailMean) return results[a].tailMean > results[b].tailMean;
+            return a < b;
+        });
+        std::vector<size_t> out;
+        for (size_t i : order) {
+            if (out.empty() || results[i].tailMean > results[out.back()].tailMean) out.push_back(i);
+        }
+        return out;
+    }
+
+private:
+    typedef std::tuple<double, double, double, double, int, int> Key;
+
+    // Whole sessions waiting to be appended to a Pairings.
+    struct Sessions {
+        std::vector<RiskInputs> inputs;
+        std::vector<double> playedChange;
+        std::vector<size_t> lengths;
+        std::vector<int> allowance;
+
+        void moveTo(Pairings& out) {
+            out.inputs.insert(out.inputs.end(), inputs.begin(), inputs.end());
+            out.playedChange.insert(out.playedChange.end(), playedChange.begin(), playedChange.end());
+            for (size_t s = 0; s < lengths.size(); ++s) {
+                out.allowance.push_back(allowance[s]);
+                out.sessionStart.push_back(out.sessionStart.back() + lengths[s]);
+            }
+            inputs.clear();
+            playedChange.clear();
+            lengths.clear();
+            allowance.clear();
+        }
+    };
+
+    // fromStore state of one player in one mode.
+    struct Track {
+        uint64_t session;  // sessions started, for the allowance stream
+        int64_t lastEndTime;
+        int length;        // games in the open session
+        bool anchored;     // RD estimate started
+        double RD;
+        int allowance;
+        Sessions open;     // priced games of the open session
+
+        Track() : session(0), lastEndTime(0), length(0), anchored(false), RD(0), allowance(0) {}
+
+        void close(Sessions& out) {
+            if (!open.inputs.empty()) {
+                out.inputs.insert(out.inputs.end(), open.inputs.begin(), open.inputs.end());
+                out.playedChange.insert(out.playedChange.end(), open.playedChange.begin(),
+                                        open.playedChange.end());
+                out.lengths.push_back(open.inputs.size());
+                out.allowance.push_back(allowance);
+            }
+            open.inputs.clear();
+            open.playedChange.clear();
+        }
+    };
+
+    static void price(const PolicyBacktest::Config& config, const GameStore::Columns& block, size_t row,
+                      std::vector<Track>& tracks, Sessions& closed) {
+        const int mode = block.mode[row];
+        if (mode >= PlayerStats::kModes || !((config.modes >> mode) & 1)) return;
+        const uint64_t stream = static_cast<uint64_t>(block.player[row]) * PlayerStats::kModes + mode + 1;
+        Track& t = tracks[stream - 1];
+
+        if (t.session == 0 || block.endTime[row] - t.lastEndTime > config.sessionGap || t.length == UINT16_MAX) {
+            t.close(closed);
+            SplitMix64 rng = SplitMix64::forStream(config.seed ^ SplitMix64::mix(stream), t.session++);
+            t.allowance = rng.range(config.minAborts, config.maxAborts);
+            t.length = 0;
+        }
+        ++t.length;
+        if (t.anchored) {
+            double days = std::max<int64_t>(0, block.endTime[row] - t.lastEndTime) / 86400.0;
+            t.RD = std::min(std::sqrt(t.RD * t.RD + config.c * config.c * days), config.maxRD);
+        }
+        t.lastEndTime = block.endTime[row];
+
+        const double before = block.ratingBefore[row], after = block.ratingAfter[row];
+        if (!t.anchored || before < 0) { // nothing to price from
+            t.anchored = true;
+            t.RD = config.initialRD;
+            return;
+        }
+        const double playerRD = std::max(t.RD, kChessComRDFloor);
+        const double oppRating = block.opponentRating[row] + (after - before);
+        const double oppRD = std::max(config.opponentRD, kChessComRDFloor);
+        RatingOutcomes o = glickoOutcomes(before, playerRD, oppRating, oppRD);
+        t.open.inputs.push_back(riskInputs(before, oppRating, o.win, o.lose, o.draw, playerRD, oppRD));
+        t.open.playedChange.push_back(after - before);
+        t.RD = o.newRD;
+    }
+
+    static Key key(const Point& p) {
+        return Key(p.params.scalingNumerator, p.params.minGain, p.params.maxLoss, p.params.riskRewardCutoff,
+                   p.minAborts, p.maxAborts);
+    }
+
+    // Smallest gap between distinct grid values; 0 for a single value.
+    static double spacing(std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        double step = 0;
+        for (size_t i = 1; i < values.size(); ++i) {
+            double gap = values[i] - values[i - 1];
+            if (gap > 0 && (step == 0 || gap < step)) step = gap;
+        }
+        return step;
+    }
+
+    static Result evaluate(const Pairings& pairings, const Point& point, double tail, std::vector<double>& gains) {
+        if (point.minAborts < 0 || point.minAborts > point.maxAborts) {
+            throw std::invalid_argument("ParameterSweep: invalid abort prior");
+        }
+        // decideRisk only sees the belief through these two numbers, indexed
+        // by aborts so far.
+        std::vector<int> states;
+        std::vector<double> abortsLeft;
+        AbortBelief belief(point.minAborts, point.maxAborts);
+        for (int k = 0; k < belief.stateCount(); ++k) {
+            states.push_back(belief.possibleStates());
+            abortsLeft.push_back(belief.expectedAbortsLeft());
+            belief.recordAbort();
+        }
+        const int lastState = belief.stateCount() - 1;
+
+        Result r = Result();
+        r.point = point;
+        gains.resize(pairings.sessions());
+        for (size_t s = 0; s < pairings.sessions(); ++s) {
+            int allowance = pairings.allowance[s];
+            int aborts = 0;
+            double gain = 0;
+            for (size_t k = pairings.sessionStart[s]; k < pairings.sessionStart[s + 1]; ++k) {
+                const RiskInputs& in = pairings.inputs[k];
+                RiskAssessment a;
+                riskTerms(in, point.params, a);
+                const int b = std::min(aborts, lastState);
+                // Rating 0 with outcome gains: decideRisk subtracts the rating
+                // from the outcomes, which leaves the gains unchanged.
+                RiskDecision d = decideRisk(0, in.winGain, in.loseGain, a.expectedValue, a.riskRewardRatio,
+                                            a.adjustedExpectedValue, states[b], abortsLeft[b], point.params);
+                if (!isAbort(d)) {
+                    ++r.played;
+                    continue;
+                }
+                ++aborts;
+                if (allowance > 0) {
+                    --allowance;
+                    ++r.aborts;
+                    gain -= pairings.playedChange[k];
+                } else {
+                    ++r.forfeits;
+                    gain += in.loseGain - pairings.playedChange[k];
+                }
+            }
+            gains[s] = gain;
+        }
+        if (gains.empty()) return r;
+
+        double sum = 0, sumSq = 0;
+        size_t worse = 0;
+        for (double g : gains) {
+            sum += g;
+            sumSq += g * g;
+            if (g < 0) ++worse;
+        }
+        const double n = static_cast<double>(gains.size());
+        r.meanGain = sum / n;
+        r.stddevGain = std::sqrt(std::max(0.0, sumSq / n - r.meanGain * r.meanGain));
+        r.worseSessions = worse / n;
+
+        const size_t worst = std::max<size_t>(1, static_cast<size_t>(std::ceil(tail * gains.size())));
+        std::nth_element(gains.begin(), gains.begin() + (worst - 1), gains.end());
+        std::sort(gains.begin(), gains.begin() + worst);
+        r.tailMean = std::accumulate(gains.begin(), gains.begin() + worst, 0.0) / worst;
+        const size_t p5 = static_cast<size_t>(0.05 * (gains.size() - 1));
+        if (p5 >= worst) std::nth_element(gains.begin() + worst, gains.begin() + p5, gains.end());
+        r.p5 = gains[p5];
+        return r;
+    }
+};
+
+#endif // PARAMETER_SWEEP_H
@@ -0,0 +1,311 @@
+#ifndef POLICY_BACKTEST_H
+#define POLICY_BACKTEST_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "GameStore.h"
+#include "Glicko.h"
+#include "ParallelFor.h"
+#include "RiskModel.h"
+#include "SessionSimulator.h"
+#include "StatsExtractor.h"
+
+// Replays stored history through an abort policy: what would the rating
+// have been had the recommended aborts been taken?
+//
+// A player's games in one mode are cut into sessions wherever two games are
+// more than `sessionGap` apart. From the player's first stored game a
+// counterfactual rating is carried through their history. Each later game
+// becomes a SessionPairing against the real opponent, priced at the
+// counterfactual rating with Glicko outcomes as in Game::calculateRatingRes.
+// If the policy plays, the real result is applied; if it aborts, the game
+// is dropped, and AbortBelief is updated just as Game does with abortsProb.
+// The site's real abort allowance is drawn per session from
+// [minAborts, maxAborts] as in SessionSimulator, and an abort beyond it is
+// scored as a forfeit loss.
+//
+// Dropping an aborted game assumes the rest of the session would have gone
+// the same; a real abort would bring a different next opponent.
+// Opponent ratings and RDs are estimated as in Backtest.
+//
+// The store is streamed twice: once to find session lengths, so the policy
+// sees pairingsLeft, then to replay, with rows grouped by player on
+// parallelFor's workers. Allowances are drawn from per-session streams and
+// the summary is built from sorted per-session results, so the report is
+// identical for any thread count.
+class PolicyBacktest {
+public:
+    struct Config {
+        int64_t sessionGap;  // seconds between games that end a session
+        unsigned modes;      // bit m set: replay PlayerStats mode m
+        int minAborts;
+        int maxAborts;
+        uint64_t seed;
+        double initialRD;
+        double maxRD;
+        double c;            // RD growth per idle day
+        double opponentRD;
+        size_t blockRows;
+        unsigned threads;    // 0 = all cores
+
+        Config()
+            : sessionGap(1800), modes((1u << PlayerStats::Bullet) | (1u << PlayerStats::Blitz)), minAborts(5),
+              maxAborts(10), seed(1), initialRD(150), maxRD(350), c(34.6), opponentRD(60), blockRows(1 << 20),
+              threads(0) {}
+    };
+
+    struct Report {
+        size_t players;
+        size_t sessions;
+        size_t pairings;
+        size_t played;
+        size_t aborts;
+        size_t forfeits;
+        double actualChange;         // summed over sessions
+        double counterfactualChange;
+        // Per-session gain: counterfactual minus actual rating change.
+        double meanGain, stddevGain;
+        double p5, p25, p50, p75, p95;
+        double worseSessions;        // share of sessions with a negative gain
+        double seconds;
+    };
+
+    template <class Policy>
+    static Report run(const GameStore& store, Policy policy, const Config& config = Config()) {
+        auto start = std::chrono::steady_clock::now();
+        if (config.minAborts > config.maxAborts || config.sessionGap <= 0 || config.blockRows == 0) {
+            throw std::invalid_argument("PolicyBacktest: invalid configuration");
+        }
+        const unsigned threads = workerCount(config.threads);
+        std::vector<Track> tracks(store.players() * PlayerStats::kModes);
+        sessionLengths(store, config, tracks);
+
+        std::vector<std::vector<SessionResult>> results(threads);
+        std::vector<Counts> counts(threads);
+        GameStore::Columns block;
+        std::vector<uint32_t> order;
+        std::vector<size_t> groups;
+        for (size_t first = 0; first < store.rows(); first += config.blockRows) {
+            store.read(first, config.blockRows, block);
+            groupByPlayer(block, order, groups);
+            parallelFor(0, groups.size() - 1, 1, [&](size_t lo, size_t hi, unsigned worker) {
+                for (size_t g = lo; g < hi; ++g) {
+                    for (size_t k = groups[g]; k < groups[g + 1]; ++k) {
+                        replay(config, policy, block, order[k], tracks, results[worker], counts[worker]);
+                    }
+                }
+            }, threads);
+        }
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            if (tracks[i].inSession) closeSession(tracks[i], results[0]);
+        }
+
+        Report report = Report();
+        std::vector<SessionResult> all;
+        for (std::vector<SessionResult>& r : results) all.insert(all.end(), r.begin(), r.end());
+        for (const Counts& c : counts) {
+            report.pairings += c.pairings;
+            report.played += c.played;
+            report.aborts += c.aborts;
+            report.forfeits += c.forfeits;
+        }
+        std::vector<char> seen(store.players(), 0);
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            if (tracks[i].anchored) seen[i / PlayerStats::kModes] = 1;
+        }
+        report.players = static_cast<size_t>(std::count(seen.begin(), seen.end(), 1));
+        summarize(all, report);
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+private:
+    struct SessionResult {
+        double gain;
+        double actual;
+        double counterfactual;
+
+        bool operator<(const SessionResult& o) const {
+            return gain != o.gain ? gain < o.gain : actual != o.actual ? actual < o.actual
+                                                                       : counterfactual < o.counterfactual;
+        }
+    };
+
+    struct Counts {
+        size_t pairings = 0, played = 0, aborts = 0, forfeits = 0;
+        char pad[64];
+    };
+
+    // Replay state of one player in one mode.
+    struct Track {
+        std::deque<uint16_t> lengths; // games per upcoming session, from the first pass
+        int64_t lastEndTime = 0;
+        bool anchored = false;        // counterfactual rating started
+        double rating = 0;            // counterfactual
+        double RD = 0;
+        bool inSession = false;
+        int left = 0;                 // games left in the session, this one included
+        uint64_t session = 0;         // sessions started, for the allowance stream
+        AbortBelief belief;
+        int allowance = 0;
+        bool exhausted = false;
+        double actualStart = 0, actualEnd = 0, cfStart = 0;
+    };
+
+    static void groupByPlayer(const GameStore::Columns& block, std::vector<uint32_t>& order,
+                              std::vector<size_t>& groups) {
+        const size_t n = block.size();
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t a, uint32_t b) { return block.player[a] < block.player[b]; });
+        groups.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (i == 0 || block.player[order[i]] != block.player[order[i - 1]]) groups.push_back(i);
+        }
+        groups.push_back(n);
+    }
+
+    static bool replayed(const Config& config, int mode) {
+        return mode < PlayerStats::kModes && ((config.modes >> mode) & 1);
+    }
+
+    // First pass: session lengths per player and mode. Only the time
+    // columns are read.
+    static void sessionLengths(const GameStore& store, const Config& config, std::vector<Track>& tracks) {
+        GameStore::Columns block;
+        std::vector<int64_t> last(tracks.size(), INT64_MIN);
+        for (size_t first = 0; first < store.rows(); first += config.blockRows) {
+            store.read(first, config.blockRows, block);
+            for (size_t i = 0; i < block.size(); ++i) {
+                if (!replayed(config, block.mode[i])) continue;
+                const size_t t = static_cast<size_t>(block.player[i]) * PlayerStats::kModes + block.mode[i];
+                std::deque<uint16_t>& lengths = tracks[t].lengths;
+                if (last[t] == INT64_MIN || block.endTime[i] - last[t] > config.sessionGap ||
+                    lengths.back() == UINT16_MAX) {
+                    lengths.push_back(0);
+                }
+                ++lengths.back();
+                last[t] = block.endTime[i];
+            }
+        }
+    }
+
+    static void closeSession(Track& t, std::vector<SessionResult>& out) {
+        if (t.inSession && t.anchored) {
+            SessionResult r;
+            r.actual = t.actualEnd - t.actualStart;
+            r.counterfactual = t.rating - t.cfStart;
+            r.gain = r.counterfactual - r.actual;
+            out.push_back(r);
+        }
+        t.inSession = false;
+    }
+
+    template <class Policy>
+    static void replay(const Config& config, const Policy& policy, const GameStore::Columns& block, size_t row,
+                       std::vector<Track>& tracks, std::vector<SessionResult>& out, Counts& counts) {
+        const int mode = block.mode[row];
+        if (!replayed(config, mode)) return;
+        const uint32_t player = block.player[row];
+        Track& t = tracks[static_cast<size_t>(player) * PlayerStats::kModes + mode];
+
+        if (t.left == 0) { // the previous session is over
+            closeSession(t, out);
+            t.left = t.lengths.front();
+            t.lengths.pop_front();
+            t.inSession = true;
+            t.belief = AbortBelief(config.minAborts, config.maxAborts);
+            const uint64_t stream = static_cast<uint64_t>(player) * PlayerStats::kModes + mode + 1;
+            SplitMix64 rng = SplitMix64::forStream(config.seed ^ SplitMix64::mix(stream), t.session++);
+            t.allowance = rng.range(config.minAborts, config.maxAborts);
+            t.exhausted = false;
+            t.actualStart = block.ratingBefore[row];
+            t.cfStart = t.rating;
+        }
+        const int pairingsLeft = t.left--;
+
+        const double before = block.ratingBefore[row], after = block.ratingAfter[row];
+        if (t.anchored) {
+            double days = std::max<int64_t>(0, block.endTime[row] - t.lastEndTime) / 86400.0;
+            t.RD = std::min(std::sqrt(t.RD * t.RD + config.c * config.c * days), config.maxRD);
+        }
+        t.lastEndTime = block.endTime[row];
+        if (!t.anchored || before < 0) {
+            // Nothing to price this game from: start (or restart) the
+            // counterfactual at the real rating after it.
+            t.anchored = true;
+            t.rating = after;
+            t.RD = config.initialRD;
+            t.inSession = t.left > 0;
+            t.actualStart = after;
+            t.cfStart = after;
+            t.actualEnd = after;
+            return;
+        }
+
+        SessionPairing p;
+        p.playerRating = t.rating;
+        p.playerRD = std::max(t.RD, kChessComRDFloor);
+        p.oppRating = block.opponentRating[row] + (after - before);
+        p.oppRD = std::max(config.opponentRD, kChessComRDFloor);
+        p.outcomes = glickoOutcomes(p.playerRating, p.playerRD, p.oppRating, p.oppRD);
+        p.pairingsLeft = pairingsLeft;
+        p.abortsExhausted = t.exhausted;
+        ++counts.pairings;
+        t.actualEnd = after;
+
+        if (policy(p, static_cast<const AbortBelief&>(t.belief))) {
+            t.belief.recordAbort();
+            if (t.allowance > 0) {
+                --t.allowance;
+                ++counts.aborts;
+                return;
+            }
+            ++counts.forfeits;
+            t.exhausted = true;
+            t.rating = p.outcomes.lose;
+            t.RD = p.outcomes.newRD;
+            return;
+        }
+        ++counts.played;
+        const int result = block.result[row];
+        t.rating = result == 2 ? p.outcomes.win : result == 1 ? p.outcomes.draw : p.outcomes.lose;
+        t.RD = p.outcomes.newRD;
+    }
+
+    static void summarize(std::vector<SessionResult>& all, Report& report) {
+        report.sessions = all.size();
+        if (all.empty()) return;
+        std::sort(all.begin(), all.end());
+        double sum = 0, sumSq = 0;
+        size_t worse = 0;
+        for (const SessionResult& r : all) {
+            sum += r.gain;
+            sumSq += r.gain * r.gain;
+            report.actualChange += r.actual;
+            report.counterfactualChange += r.counterfactual;
+            if (r.gain < 0) ++worse;
+        }
+        const double n = static_cast<double>(all.size());
+        report.meanGain = sum / n;
+        report.stddevGain = std::sqrt(std::max(0.0, sumSq / n - report.meanGain * report.meanGain));
+        auto quantile = [&](double f) { return all[static_cast<size_t>(f * (all.size() - 1))].gain; };
+        report.p5 = quantile(0.05);
+        report.p25 = quantile(0.25);
+        report.p50 = quantile(0.50);
+        report.p75 = quantile(0.75);
+        report.p95 = quantile(0.95);
+        report.worseSessions = worse / n;
+    }
+};
+
+#endif // POLICY_BACKTEST_H
@@ -0,0 +1,176 @@
+#ifndef RD_GRID_SEARCH_H
+#define RD_GRID_SEARCH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "GlickoBatch.h"
+#include "ParallelFor.h"
+#include "RDSolver.h"
+
+// Exhaustive (RD, RD_j) search, the grid counterpart of RDSolver. All
+// observations are assumed to share one (RD, RD_j) pair, e.g. games where both
+// players sit on the RD floor, and the search minimises the summed squared
+// error over them.
+//
+// Rows of the grid (fixed RD) are split across cores by parallelFor's work
+// stealing; each row is scored for every RD_j column at once through
+// GlickoBatch. With refineLevels > 0 the best cell is re-searched with a step
+// refineFactor times smaller in a window of +-refineRadius old steps.
+class RDGridSearch {
+public:
+    struct Config {
+        double rdMin, rdMax;
+        double rdjMin, rdjMax;
+        double step;        // may be fractional, e.g. 0.1
+        int refineLevels;
+        double refineFactor;
+        double refineRadius;
+        unsigned threads;
+
+        Config() : rdMin(1), rdMax(500), rdjMin(1), rdjMax(350), step(1), refineLevels(0),
+                   refineFactor(10), refineRadius(2), threads(0) {}
+    };
+
+    struct Result {
+        double RD;
+        double RD_j;
+        double rmsError;
+        double maxError;
+        size_t evaluations; // glickoNewRating evaluations over all levels
+    };
+
+    static Result search(const std::vector<RatingObservation>& observations, const Config& config = Config()) {
+        Result res = {0, 0, std::numeric_limits<double>::max(), 0, 0};
+        if (observations.empty()) return res;
+
+        double rdLo = config.rdMin, rdHi = config.rdMax;
+        double rdjLo = config.rdjMin, rdjHi = config.rdjMax;
+        double step = config.step;
+        Best best = {std::numeric_limits<double>::max(), 0, 0};
+        for (int level = 0; level <= config.refineLevels; ++level) {
+            searchLevel(observations, rdLo, rdHi, rdjLo, rdjHi, step, config.threads, best, res);
+            double radius = config.refineRadius * step;
+            rdLo = std::max(config.rdMin, res.RD - radius);
+            rdHi = std::min(config.rdMax, res.RD + radius);
+            rdjLo = std::max(config.rdjMin, res.RD_j - radius);
+            rdjHi = std::min(config.rdjMax, res.RD_j + radius);
+            step /= config.refineFactor;
+        }
+        return res;
+    }
+
+private:
+    struct Best {
+        double sse;
+        double RD, RD_j;
+
+        // Ties go to the smaller (RD, RD_j) so the answer does not depend on
+        // how rows were split between threads.
+        bool betterThan(const Best& o) const {
+            if (sse != o.sse) return sse < o.sse;
+            if (RD != o.RD) return RD < o.RD;
+            return RD_j < o.RD_j;
+        }
+    };
+
+    // Per-worker SoA buffers, one entry per RD_j column.
+    struct Scratch {
+        std::vector<double> r, RD, r_j, RD_j, s, out, sse;
+
+        void resize(size_t n) {
+            r.resize(n);
+            RD.resize(n);
+            r_j.resize(n);
+            RD_j.resize(n);
+            s.resize(n);
+            out.resize(n);
+            sse.resize(n);
+        }
+    };
+
+    static void searchLevel(const std::vector<RatingObservation>& observations, double rdLo, double rdHi,
+                            double rdjLo, double rdjHi, double step, unsigned threads, Best& overall,
+                            Result& res) {
+        // Grid points are lo + k * step so fractional steps do not accumulate error.
+        size_t rows = static_cast<size_t>(std::floor((rdHi - rdLo) / step + 1e-9)) + 1;
+        size_t cols = static_cast<size_t>(std::floor((rdjHi - rdjLo) / step + 1e-9)) + 1;
+        std::vector<double> colRD_j(cols);
+        for (size_t c = 0; c < cols; ++c) colRD_j[c] = rdjLo + c * step;
+
+        unsigned workers = workerCount(threads);
+        std::vector<Scratch> scratch(workers);
+        std::vector<Best> best(workers, Best{std::numeric_limits<double>::max(), 0, 0});
+        for (Scratch& sc : scratch) sc.resize(cols);
+
+        parallelFor(0, rows, 1, [&](size_t lo, size_t hi, unsigned w) {
+            Scratch& sc = scratch[w];
+            for (size_t row = lo; row < hi; ++row) {
+                double RD = rdLo + row * step;
+                std::fill(sc.sse.begin(), sc.sse.end(), 0.0);
+                for (const RatingObservation& obs : observations) {
+                    // Player side: RD fixed for the row, RD_j along the columns.
+                    std::fill(sc.r.begin(), sc.r.end(), obs.r);
+                    std::fill(sc.RD.begin(), sc.RD.end(), RD);
+                    std::fill(sc.r_j.begin(), sc.r_j.end(), obs.r_j);
+                    std::fill(sc.s.begin(), sc.s.end(), obs.s);
+                    GlickoBatch::calculateNewRatings(sc.r.data(), sc.RD.data(), sc.r_j.data(), colRD_j.data(),
+                                                     sc.s.data(), sc.out.data(), cols);
+                    accumulate(sc, obs.observed_new_r);
+
+                    if (!std::isnan(obs.observed_new_r_j)) {
+                        // Opponent side: the roles of RD and RD_j swap.
+                        std::fill(sc.r.begin(), sc.r.end(), obs.r_j);
+                        std::fill(sc.r_j.begin(), sc.r_j.end(), obs.r);
+                        std::fill(sc.RD_j.begin(), sc.RD_j.end(), RD);
+                        std::fill(sc.s.begin(), sc.s.end(), 1 - obs.s);
+                        GlickoBatch::calculateNewRatings(sc.r.data(), colRD_j.data(), sc.r_j.data(), sc.RD_j.data(),
+                                                         sc.s.data(), sc.out.data(), cols);
+                        accumulate(sc, obs.observed_new_r_j);
+                    }
+                }
+                for (size_t c = 0; c < cols; ++c) {
+                    Best cell = {sc.sse[c], RD, colRD_j[c]};
+                    if (cell.betterThan(best[w])) best[w] = cell;
+                }
+            }
+        }, threads);
+
+        size_t terms = 0;
+        for (const RatingObservation& obs : observations) {
+            terms += std::isnan(obs.observed_new_r_j) ? 1 : 2;
+        }
+        res.evaluations += rows * cols * terms;
+
+        // A refined window may miss the previous cell by rounding; keep
+        // whichever is better.
+        for (const Best& b : best) {
+            if (b.betterThan(overall)) overall = b;
+        }
+        res.RD = overall.RD;
+        res.RD_j = overall.RD_j;
+        res.rmsError = std::sqrt(overall.sse / terms);
+        res.maxError = 0;
+        for (const RatingObservation& obs : observations) {
+            res.maxError = std::max(res.maxError, std::abs(glickoNewRating(obs.r, res.RD, obs.r_j, res.RD_j, obs.s) -
+                                                           obs.observed_new_r));
+            if (!std::isnan(obs.observed_new_r_j)) {
+                res.maxError = std::max(res.maxError,
+                                        std::abs(glickoNewRating(obs.r_j, res.RD_j, obs.r, res.RD, 1 - obs.s) -
+                                                 obs.observed_new_r_j));
+            }
+        }
+    }
+
+    static void accumulate(Scratch& sc, double observed) {
+        const size_t n = sc.out.size();
+        for (size_t c = 0; c < n; ++c) {
+            double e = sc.out[c] - observed;
+            sc.sse[c] += e * e;
+        }
+    }
+};
+
+#endif // RD_GRID_SEARCH_H
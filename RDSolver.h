@@ -0,0 +1,298 @@
+#ifndef RD_SOLVER_H
+#define RD_SOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "Glicko.h"
+#include "ParallelFor.h"
+
+// Recovers the RDs behind observed rating changes. This replaces the README's
+// reverseEngineerRD grid scan (175,000 evaluations per game) with safeguarded
+// Newton iterations on the analytic derivatives of glickoNewRating.
+//
+// One observed post-game rating is one equation, so it determines the player's
+// RD only when the opponent's RD is known. When the opponent's post-game rating
+// for the same game is also known, the two equations usually determine
+// (RD, RD_j) jointly; when the ratings are far apart they can have several
+// roots, and such estimates are flagged as ambiguous.
+
+// One observed game. Unknown fields are NaN.
+struct RatingObservation {
+    double r, r_j, s;
+    double observed_new_r;    // player's rating after the game
+    double observed_new_r_j;  // opponent's rating after the game, or NaN
+    double RD_j;              // opponent's RD if known, or NaN
+
+    RatingObservation(double r, double r_j, double s, double observed_new_r,
+                      double observed_new_r_j = std::numeric_limits<double>::quiet_NaN(),
+                      double RD_j = std::numeric_limits<double>::quiet_NaN())
+        : r(r), r_j(r_j), s(s), observed_new_r(observed_new_r),
+          observed_new_r_j(observed_new_r_j), RD_j(RD_j) {}
+};
+
+struct RDEstimate {
+    double RD;
+    double RD_j;
+    double residual;   // model minus observed, player side
+    double residual_j; // model minus observed, opponent side (NaN if not observed)
+    double sensitivity; // rating points per RD point in the least sensitive direction
+    int iterations;
+    bool converged;    // residuals within tolerance and, for a joint solve, the only root found
+    bool ambiguous;    // joint solve: another (RD, RD_j) in range fits as well
+};
+
+// Partial derivatives of glickoNewRating with respect to RD and RD_j.
+inline void glickoPartials(double r, double RD, double r_j, double RD_j, double s,
+                           double& dRD, double& dRD_j) {
+    const double k = 3 * q * q / (pi * pi);
+    const double L = std::log(10.0) / 400;
+    double g = 1 / std::sqrt(1 + k * RD_j * RD_j);
+    double diff = r - r_j;
+    double E = 1 / (1 + std::pow(10, -g * diff / 400));
+    double EE = E * (1 - E);
+
+    double dE_dg = EE * L * diff;
+    double S = g * g * EE;
+    double dS_dg = 2 * g * EE + g * g * (1 - 2 * E) * dE_dg;
+    double denom = 1 / (RD * RD) + q * q * S;
+    double num = g * (s - E);
+    double dnum_dg = (s - E) - g * dE_dg;
+
+    dRD = 2 * q * num / (denom * denom * RD * RD * RD);
+    double dNew_dg = q * (dnum_dg * denom - num * q * q * dS_dg) / (denom * denom);
+    dRD_j = dNew_dg * (-k * RD_j * g * g * g);
+}
+
+class RDSolver {
+public:
+    struct Config {
+        double rdMin, rdMax;
+        double assumedRD_j; // used when neither RD_j nor the opponent's result is known
+        double tolerance;   // rating points
+        int maxIterations;
+        unsigned threads;
+
+        Config() : rdMin(1), rdMax(500), assumedRD_j(kChessComRDFloor), tolerance(1e-9), maxIterations(60),
+                   threads(0) {}
+    };
+
+    // Player RD with the opponent's RD fixed. new_r is monotonic in RD, so the
+    // root is bracketed on [rdMin, rdMax] and Newton steps that leave the
+    // bracket fall back to bisection.
+    static RDEstimate solveRD(const RatingObservation& obs, double RD_j, const Config& config = Config()) {
+        RDEstimate est = {0, RD_j, 0, std::numeric_limits<double>::quiet_NaN(), 0, 0, false, false};
+        auto F = [&](double RD) { return glickoNewRating(obs.r, RD, obs.r_j, RD_j, obs.s) - obs.observed_new_r; };
+
+        double lo = config.rdMin, hi = config.rdMax;
+        double flo = F(lo), fhi = F(hi);
+        if (flo * fhi > 0) {
+            // Observation is outside what any RD in range can produce.
+            bool loBetter = std::abs(flo) < std::abs(fhi);
+            est.RD = loBetter ? lo : hi;
+            est.residual = loBetter ? flo : fhi;
+            est.sensitivity = sensitivity1D(obs, est.RD, RD_j);
+            return est;
+        }
+
+        double x = std::abs(flo) < std::abs(fhi) ? lo : hi;
+        double fx = std::abs(flo) < std::abs(fhi) ? flo : fhi;
+        for (int it = 0; it < config.maxIterations; ++it) {
+            est.iterations = it + 1;
+            if (std::abs(fx) <= config.tolerance) {
+                est.converged = true;
+                break;
+            }
+            double dRD, dRD_j;
+            glickoPartials(obs.r, x, obs.r_j, RD_j, obs.s, dRD, dRD_j);
+            double next = dRD != 0 ? x - fx / dRD : lo;
+            if (!(next > lo && next < hi)) {
+                next = (lo + hi) / 2;
+            }
+            double fnext = F(next);
+            if ((fnext < 0) == (flo < 0)) {
+                lo = next;
+                flo = fnext;
+            } else {
+                hi = next;
+            }
+            x = next;
+            fx = fnext;
+            if (hi - lo < 1e-12 * hi) {
+                est.converged = std::abs(fx) <= config.tolerance;
+                break;
+            }
+        }
+        est.RD = x;
+        est.residual = fx;
+        est.sensitivity = sensitivity1D(obs, x, RD_j);
+        return est;
+    }
+
+    // (RD, RD_j) from both players' post-game ratings. Damped Newton on the
+    // 2x2 system, projected onto [rdMin, rdMax]^2 and restarted from a few
+    // seeds; the best residual wins.
+    //
+    // With the ratings far apart E is near 0 or 1, both equations are nearly
+    // flat and the system can have more than one exact root. If the Jacobian
+    // at the root is that weak (sensitivity below kProbeSensitivity), the
+    // solve is repeated from a grid of seeds; when another root fits as well
+    // the estimate is marked ambiguous instead of converged.
+    static RDEstimate solveJoint(const RatingObservation& obs, const Config& config = Config()) {
+        const double seeds[][2] = {{55, 55}, {150, 150}, {350, 350}, {55, 350}, {350, 55}};
+        RDEstimate best = {0, 0, 0, 0, 0, 0, false, false};
+        double bestNorm = std::numeric_limits<double>::max();
+        for (const auto& seed : seeds) {
+            RDEstimate est = newton2D(obs, seed[0], seed[1], config);
+            double norm = std::max(std::abs(est.residual), std::abs(est.residual_j));
+            if (norm < bestNorm) {
+                bestNorm = norm;
+                best = est;
+            }
+            if (est.converged) break;
+        }
+        best.sensitivity = sensitivity2D(obs, best.RD, best.RD_j);
+        if (!best.converged || best.sensitivity >= kProbeSensitivity) return best;
+
+        const double probes[] = {30, 100, 250, 500};
+        auto clamp = [&](double x) { return std::min(std::max(x, config.rdMin), config.rdMax); };
+        for (double a : probes) {
+            for (double b : probes) {
+                RDEstimate other = newton2D(obs, clamp(a), clamp(b), config);
+                if (other.converged &&
+                    std::max(std::abs(other.RD - best.RD), std::abs(other.RD_j - best.RD_j)) > kDistinctRD) {
+                    best.converged = false;
+                    best.ambiguous = true;
+                    return best;
+                }
+            }
+        }
+        return best;
+    }
+
+    // Picks the solve that the observation supports.
+    static RDEstimate solve(const RatingObservation& obs, const Config& config = Config()) {
+        if (!std::isnan(obs.observed_new_r_j)) return solveJoint(obs, config);
+        if (!std::isnan(obs.RD_j)) return solveRD(obs, obs.RD_j, config);
+        return solveRD(obs, config.assumedRD_j, config);
+    }
+
+    static std::vector<RDEstimate> solveBatch(const std::vector<RatingObservation>& observations,
+                                              const Config& config = Config()) {
+        std::vector<RDEstimate> out(observations.size());
+        parallelFor(0, observations.size(), 256, [&](size_t lo, size_t hi, unsigned) {
+            for (size_t i = lo; i < hi; ++i) {
+                out[i] = solve(observations[i], config);
+            }
+        }, config.threads);
+        return out;
+    }
+
+    struct Summary {
+        size_t count;
+        size_t converged;
+        size_t ambiguous;
+        double maxResidual;
+        double rmsResidual;
+        size_t nearFloor; // estimates with RD within floorTolerance of the floor
+    };
+
+    // Aggregate residuals, and how many recovered RDs sit on the RD floor
+    // (kChessComRDFloor, as in Game::calculateRatingRes).
+    static Summary summarize(const std::vector<RDEstimate>& estimates, double floor = kChessComRDFloor,
+                             double floorTolerance = 0.5) {
+        Summary sum = {estimates.size(), 0, 0, 0, 0, 0};
+        double sq = 0;
+        for (const RDEstimate& e : estimates) {
+            if (e.converged) ++sum.converged;
+            if (e.ambiguous) ++sum.ambiguous;
+            double res = std::abs(e.residual);
+            if (!std::isnan(e.residual_j)) res = std::max(res, std::abs(e.residual_j));
+            sum.maxResidual = std::max(sum.maxResidual, res);
+            sq += res * res;
+            if (std::abs(e.RD - floor) <= floorTolerance) ++sum.nearFloor;
+        }
+        sum.rmsResidual = estimates.empty() ? 0 : std::sqrt(sq / estimates.size());
+        return sum;
+    }
+
+private:
+    // Below this many rating points per RD point a joint root is checked for
+    // uniqueness; roots further apart than kDistinctRD count as different.
+    static constexpr double kProbeSensitivity = 0.1;
+    static constexpr double kDistinctRD = 0.01;
+
+    static double sensitivity1D(const RatingObservation& obs, double RD, double RD_j) {
+        double dRD, dRD_j;
+        glickoPartials(obs.r, RD, obs.r_j, RD_j, obs.s, dRD, dRD_j);
+        return std::abs(dRD);
+    }
+
+    // Smallest singular value of the Jacobian of both equations.
+    static double sensitivity2D(const RatingObservation& obs, double RD, double RD_j) {
+        double a11, a12, a21, a22;
+        glickoPartials(obs.r, RD, obs.r_j, RD_j, obs.s, a11, a12);
+        glickoPartials(obs.r_j, RD_j, obs.r, RD, 1 - obs.s, a22, a21);
+        const double det = std::abs(a11 * a22 - a12 * a21);
+        const double frob = a11 * a11 + a12 * a12 + a21 * a21 + a22 * a22;
+        const double largest = std::sqrt((frob + std::sqrt(std::max(0.0, frob * frob - 4 * det * det))) / 2);
+        return largest > 0 ? det / largest : 0;
+    }
+
+    static RDEstimate newton2D(const RatingObservation& obs, double RD, double RD_j, const Config& config) {
+        auto residuals = [&](double a, double b, double& f1, double& f2) {
+            f1 = glickoNewRating(obs.r, a, obs.r_j, b, obs.s) - obs.observed_new_r;
+            f2 = glickoNewRating(obs.r_j, b, obs.r, a, 1 - obs.s) - obs.observed_new_r_j;
+        };
+        auto clamp = [&](double x) { return std::min(std::max(x, config.rdMin), config.rdMax); };
+
+        RDEstimate est = {RD, RD_j, 0, 0, 0, 0, false, false};
+        double f1, f2;
+        residuals(RD, RD_j, f1, f2);
+        for (int it = 0; it < config.maxIterations; ++it) {
+            est.iterations = it + 1;
+            if (std::max(std::abs(f1), std::abs(f2)) <= config.tolerance) {
+                est.converged = true;
+                break;
+            }
+            // J = [[d1/dRD, d1/dRD_j], [d2/dRD, d2/dRD_j]]; the opponent's
+            // equation has the roles of RD and RD_j swapped.
+            double a11, a12, a21, a22;
+            glickoPartials(obs.r, RD, obs.r_j, RD_j, obs.s, a11, a12);
+            glickoPartials(obs.r_j, RD_j, obs.r, RD, 1 - obs.s, a22, a21);
+            double det = a11 * a22 - a12 * a21;
+            if (det == 0 || std::isnan(det)) break;
+            double stepRD = (a22 * f1 - a12 * f2) / det;
+            double stepRD_j = (a11 * f2 - a21 * f1) / det;
+
+            // Backtrack until the residual norm decreases.
+            double norm = f1 * f1 + f2 * f2;
+            double lambda = 1;
+            bool improved = false;
+            for (int k = 0; k < 30; ++k, lambda /= 2) {
+                double nRD = clamp(RD - lambda * stepRD);
+                double nRD_j = clamp(RD_j - lambda * stepRD_j);
+                double g1, g2;
+                residuals(nRD, nRD_j, g1, g2);
+                if (g1 * g1 + g2 * g2 < norm) {
+                    RD = nRD;
+                    RD_j = nRD_j;
+                    f1 = g1;
+                    f2 = g2;
+                    improved = true;
+                    break;
+                }
+            }
+            if (!improved) break;
+        }
+        est.RD = RD;
+        est.RD_j = RD_j;
+        est.residual = f1;
+        est.residual_j = f2;
+        return est;
+    }
+};
+
+#endif // RD_SOLVER_H
@@ -0,0 +1,138 @@
+#ifndef RATING_PERIOD_ENGINE_H
+#define RATING_PERIOD_ENGINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "Glicko.h"
+#include "ParallelFor.h"
+
+// One game of a rating period between two player indices. `score` is the
+// result for `white` (1 win, 0.5 draw, 0 loss).
+struct PeriodGame {
+    uint32_t white;
+    uint32_t black;
+    float score;
+};
+
+// All games of one rating period in CSR form: the games of player i are
+// opponents[offsets[i] .. offsets[i + 1]) with the matching scores from i's
+// point of view. Every game appears once in each player's row.
+struct PeriodGames {
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> opponents;
+    std::vector<float> scores;
+
+    size_t players() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    size_t gamesOf(size_t player) const { return offsets[player + 1] - offsets[player]; }
+
+    // Counting-sort a flat game list into per-player rows.
+    static PeriodGames fromGames(size_t players, const std::vector<PeriodGame>& games) {
+        PeriodGames csr;
+        csr.offsets.assign(players + 1, 0);
+        for (const PeriodGame& g : games) {
+            if (g.white >= players || g.black >= players) {
+                throw std::out_of_range("PeriodGames: player index out of range");
+            }
+            ++csr.offsets[g.white + 1];
+            ++csr.offsets[g.black + 1];
+        }
+        for (size_t i = 0; i < players; ++i) {
+            csr.offsets[i + 1] += csr.offsets[i];
+        }
+        csr.opponents.resize(csr.offsets[players]);
+        csr.scores.resize(csr.offsets[players]);
+        std::vector<size_t> cursor(csr.offsets.begin(), csr.offsets.end() - 1);
+        for (const PeriodGame& g : games) {
+            size_t w = cursor[g.white]++;
+            csr.opponents[w] = g.black;
+            csr.scores[w] = g.score;
+            size_t b = cursor[g.black]++;
+            csr.opponents[b] = g.white;
+            csr.scores[b] = 1.0f - g.score;
+        }
+        return csr;
+    }
+};
+
+// Glicko-1 rating-period update (Step 1 and Step 2 in analyzer.h) for a whole
+// population. Every player is updated from the ratings and RDs at the onset of
+// the period, so rows are independent and are processed in parallel.
+class RatingPeriodEngine {
+public:
+    struct Config {
+        double c;        // RD growth per idle period
+        double minRD;    // "RD should never drop below 30"
+        double maxRD;
+        unsigned threads; // 0 = all cores
+
+        Config() : c(34.6), minRD(30), maxRD(350), threads(0) {}
+    };
+
+    std::vector<double> rating;
+    std::vector<double> RD;
+
+    RatingPeriodEngine(size_t players, double initialRating = 1500, double initialRD = 350,
+                       Config config = Config())
+        : rating(players, initialRating), RD(players, initialRD), config(config) {}
+
+    size_t players() const { return rating.size(); }
+
+    // Step 1: RD = min(sqrt(oldRD^2 + c^2 t), maxRD) for one player.
+    double onsetRD(double oldRD, double t) const {
+        return std::min(std::sqrt(oldRD * oldRD + config.c * config.c * t), config.maxRD);
+    }
+
+    // Applies one rating period. `t` is the number of rating periods since the
+    // previous call (1 for consecutive periods).
+    void runPeriod(const PeriodGames& games, double t = 1) {
+        const size_t n = players();
+        if (games.players() != n) {
+            throw std::invalid_argument("RatingPeriodEngine: game list is for a different population");
+        }
+
+        std::vector<double> preRD(n);
+        parallelFor(0, n, 1 << 14, [&](size_t lo, size_t hi, unsigned) {
+            for (size_t i = lo; i < hi; ++i) {
+                preRD[i] = onsetRD(RD[i], t);
+            }
+        }, config.threads);
+
+        std::vector<double> newRating(n), newRD(n);
+        parallelFor(0, n, 1 << 10, [&](size_t lo, size_t hi, unsigned) {
+            for (size_t i = lo; i < hi; ++i) {
+                updatePlayer(games, preRD, i, newRating[i], newRD[i]);
+            }
+        }, config.threads);
+
+        rating.swap(newRating);
+        RD.swap(newRD);
+    }
+
+private:
+    Config config;
+
+    // Step 2 for one player over all of their games this period.
+    void updatePlayer(const PeriodGames& games, const std::vector<double>& preRD, size_t i,
+                      double& outRating, double& outRD) const {
+        const double r = rating[i];
+        const size_t begin = games.offsets[i], end = games.offsets[i + 1];
+        if (begin == end) {
+            outRating = r;
+            outRD = preRD[i];
+            return;
+        }
+
+        GlickoPeriodSums sums;
+        for (size_t k = begin; k < end; ++k) {
+            uint32_t j = games.opponents[k];
+            sums.add(r, rating[j], preRD[j], games.scores[k]);
+        }
+        sums.finish(r, preRD[i], config.minRD, outRating, outRD);
+    }
+};
+
+#endif // RATING_PERIOD_ENGINE_H
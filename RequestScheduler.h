@@ -0,0 +1,326 @@
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CurlPool.h"
+#include "MultiFetch.h"
+
+// Front door for Chess.com API requests.
+//
+//  - Single flight: a URL requested while the same URL is already queued or
+//    in flight joins that request instead of sending another one, so a
+//    lookup and a background job asking for the same player cost one call.
+//  - Token bucket: at most `burst` requests back to back, then
+//    `ratePerSecond` on average.
+//  - 429 and 5xx responses (and transport errors) are retried with
+//    exponential backoff and jitter, or after the server's Retry-After. A
+//    429 also pauses every request until then, since it applies to the
+//    client rather than to one URL.
+//  - Interactive requests are always sent before background ones that are
+//    ready at the same time.
+//
+// Worker threads hand the requests to MultiFetch's curl_multi loop and wait
+// for them there, so the transfers in flight share warm connections (one
+// multiplexed HTTP/2 connection to the API) and CurlPool's timeouts. The
+// workers only wait, which is why there can be dozens of them; the token
+// bucket rather than the worker count is what limits the request rate. A
+// request whose callers have all cancelled it is dropped from the queue, or
+// stopped mid-transfer through the fetch's abort hook; the same hook stops
+// every transfer when the scheduler shuts down. The fetch function can be
+// replaced, e.g. to point the scheduler at a mock server in a test.
+class RequestScheduler {
+public:
+    enum Priority { Interactive, Background };
+
+    typedef CurlPool::Response Response;
+    typedef std::function<bool()> Abort;
+    // Must return (or throw) soon after `abort` starts returning true.
+    typedef std::function<Response(const std::string& url, const Abort& abort)> Fetch;
+
+    struct Config {
+        double ratePerSecond;
+        double burst;
+        int maxRetries;     // after the first attempt
+        double backoffBase; // seconds before the first retry, doubling after that
+        double backoffMax;
+        unsigned workers;   // requests in flight at once
+
+        Config() : ratePerSecond(8), burst(8), maxRetries(4), backoffBase(0.5), backoffMax(30), workers(32) {}
+    };
+
+    struct Stats {
+        size_t requests;  // submit() calls
+        size_t coalesced; // ... that joined a pending request
+        size_t attempts;  // HTTP requests sent
+        size_t retries;
+        size_t throttled; // 429 responses
+        size_t cancelled; // requests dropped by cancel()
+    };
+
+    static RequestScheduler& instance() {
+        static RequestScheduler scheduler;
+        return scheduler;
+    }
+
+    explicit RequestScheduler(const Config& config = Config(), Fetch fetch = Fetch())
+        : config(config), fetch(fetch), stats_(), tokens(config.burst), refilled(Clock::now()),
+          pausedUntil(Clock::now()), stopping(false), rng(std::random_device()()) {
+        if (config.ratePerSecond <= 0 || config.burst < 1) {
+            throw std::invalid_argument("RequestScheduler: rate must be positive and burst at least 1");
+        }
+        if (!this->fetch) {
+            // Construct the loop first so that it outlives a static scheduler.
+            MultiFetch& multi = MultiFetch::instance();
+            this->fetch = [&multi](const std::string& url, const Abort& abort) { return multi.get(url, abort); };
+        }
+        for (unsigned i = 0; i < std::max(config.workers, 1u); ++i) {
+            threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~RequestScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads) t.join();
+        for (std::deque<JobPtr>& queue : queues) {
+            for (JobPtr& job : queue) fail(job, "RequestScheduler stopped");
+        }
+    }
+
+    RequestScheduler(const RequestScheduler&) = delete;
+    RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+    // Queues a GET of `url`, or joins the one already pending. The future
+    // holds the final response; HTTP errors that are not retried, or still
+    // fail after the last retry, are returned as is. Transport errors that
+    // outlast the retries are thrown from get().
+    std::shared_future<Response> submit(const std::string& url, Priority priority = Interactive) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats_.requests;
+        auto it = pending.find(url);
+        if (it != pending.end()) {
+            ++stats_.coalesced;
+            JobPtr job = it->second;
+            ++job->waiters;
+            if (priority < job->priority) promote(job, priority);
+            return job->future;
+        }
+        JobPtr job = std::make_shared<Job>();
+        job->url = url;
+        job->priority = priority;
+        job->attempt = 0;
+        job->waiters = 1;
+        job->notBefore = Clock::now();
+        job->future = job->promise.get_future().share();
+        pending[url] = job;
+        queues[priority].push_back(job);
+        wake.notify_one();
+        return job->future;
+    }
+
+    Response get(const std::string& url, Priority priority = Interactive) { return submit(url, priority).get(); }
+
+    // Withdraws one submit() of `url`. Once every caller that submitted the
+    // pending request has withdrawn, it is taken off the queue or its
+    // transfer is aborted, and its future fails with "Cancelled".
+    void cancel(const std::string& url) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(url);
+        if (it == pending.end()) return;
+        JobPtr job = it->second;
+        if (--job->waiters > 0) return;
+        pending.erase(it);
+        job->cancelled = true;
+        ++stats_.cancelled;
+        std::deque<JobPtr>& queue = queues[job->priority];
+        auto queued = std::find(queue.begin(), queue.end(), job);
+        if (queued != queue.end()) {
+            queue.erase(queued);
+            fail(job, "Cancelled");
+        }
+        // Otherwise it is in flight; the worker fails it once fetch returns.
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats_;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Job {
+        std::string url;
+        Priority priority;
+        int attempt;
+        int waiters; // submit() calls not withdrawn by cancel()
+        std::atomic<bool> cancelled{false};
+        Clock::time_point notBefore;
+        std::promise<Response> promise;
+        std::shared_future<Response> future;
+    };
+    typedef std::shared_ptr<Job> JobPtr;
+
+    Config config;
+    Fetch fetch;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::map<std::string, JobPtr> pending; // queued or in flight, by URL
+    std::deque<JobPtr> queues[2];          // by Priority
+    Stats stats_;
+    double tokens;
+    Clock::time_point refilled;
+    Clock::time_point pausedUntil;
+    std::atomic<bool> stopping;
+    std::minstd_rand rng;
+    std::vector<std::thread> threads; // last, so they start after the members they use
+
+    // Moves a queued job to a more urgent queue; a job in flight keeps its
+    // place, and a retry is queued under the new priority.
+    void promote(const JobPtr& job, Priority priority) {
+        std::deque<JobPtr>& from = queues[job->priority];
+        auto it = std::find(from.begin(), from.end(), job);
+        job->priority = priority;
+        if (it == from.end()) return;
+        from.erase(it);
+        queues[priority].push_back(job);
+        wake.notify_one();
+    }
+
+    static void fail(const JobPtr& job, const char* what) {
+        job->promise.set_exception(std::make_exception_ptr(std::runtime_error(what)));
+    }
+
+    void refill(Clock::time_point now) {
+        double elapsed = std::chrono::duration<double>(now - refilled).count();
+        tokens = std::min(config.burst, tokens + elapsed * config.ratePerSecond);
+        refilled = now;
+    }
+
+    // Takes the first ready job, interactive before background. Otherwise
+    // lowers `wakeAt` to when the next one becomes ready.
+    JobPtr take(Clock::time_point now, Clock::time_point& wakeAt) {
+        for (std::deque<JobPtr>& queue : queues) {
+            for (auto it = queue.begin(); it != queue.end(); ++it) {
+                if ((*it)->notBefore <= now) {
+                    JobPtr job = *it;
+                    queue.erase(it);
+                    return job;
+                }
+                wakeAt = std::min(wakeAt, (*it)->notBefore);
+            }
+        }
+        return JobPtr();
+    }
+
+    bool hasReady(Clock::time_point now) const {
+        for (const std::deque<JobPtr>& queue : queues) {
+            for (const JobPtr& job : queue) {
+                if (job->notBefore <= now) return true;
+            }
+        }
+        return false;
+    }
+
+    double backoff(int attempt) {
+        double cap = std::min(config.backoffMax, config.backoffBase * std::pow(2.0, attempt));
+        return std::uniform_real_distribution<double>(0.5, 1.0)(rng) * cap;
+    }
+
+    static Clock::time_point after(Clock::time_point t, double seconds) {
+        return t + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            if (stopping) return;
+            const Clock::time_point now = Clock::now();
+            Clock::time_point wakeAt = Clock::time_point::max();
+            JobPtr job;
+            if (now < pausedUntil) {
+                wakeAt = pausedUntil;
+            } else {
+                refill(now);
+                if (tokens >= 1) {
+                    job = take(now, wakeAt);
+                } else if (hasReady(now)) {
+                    wakeAt = after(now, (1 - tokens) / config.ratePerSecond);
+                } else {
+                    take(now, wakeAt); // nothing ready; only sets wakeAt
+                }
+            }
+            if (!job) {
+                if (wakeAt == Clock::time_point::max()) {
+                    wake.wait(lock);
+                } else {
+                    wake.wait_until(lock, wakeAt);
+                }
+                continue;
+            }
+            tokens -= 1;
+            ++stats_.attempts;
+
+            lock.unlock();
+            Response response = Response();
+            std::exception_ptr error;
+            try {
+                response = fetch(job->url, [this, &job]() { return job->cancelled || stopping; });
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            if (job->cancelled) {
+                fail(job, "Cancelled");
+                continue;
+            }
+
+            const bool throttled = !error && response.status == 429;
+            if (throttled) ++stats_.throttled;
+            const bool retryable = error || throttled || response.status >= 500;
+            if (retryable && job->attempt < config.maxRetries && !stopping) {
+                const double delay = response.retryAfter > 0 ? response.retryAfter : backoff(job->attempt);
+                const Clock::time_point at = after(Clock::now(), delay);
+                if (throttled) {
+                    pausedUntil = std::max(pausedUntil, at);
+                    tokens = 0;
+                }
+                ++job->attempt;
+                ++stats_.retries;
+                job->notBefore = at;
+                queues[job->priority].push_back(job);
+                wake.notify_all();
+                continue;
+            }
+
+            pending.erase(job->url); // not cancelled, so still the pending job for its URL
+            if (error) {
+                job->promise.set_exception(error);
+            } else {
+                job->promise.set_value(response);
+            }
+        }
+    }
+};
+
+#endif // REQUEST_SCHEDULER_H
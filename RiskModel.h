@@ -0,0 +1,204 @@
+#ifndef RISK_MODEL_H
+#define RISK_MODEL_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// The play/abort model behind Game::analyzeRisk, split out so that batch
+// screening, simulation and backtesting run the same arithmetic.
+
+enum class RiskDecision : uint8_t {
+    PlayPositiveEV,      // positive EV with a favourable risk-reward ratio
+    AbortHighRisk,       // potential loss beyond the maximum acceptable loss
+    AbortInsufficientEV, // negative or insufficient EV while aborts remain
+    PlayLimitedAborts,   // no aborts expected to be left
+};
+
+inline bool isAbort(RiskDecision d) {
+    return d == RiskDecision::AbortHighRisk || d == RiskDecision::AbortInsufficientEV;
+}
+
+inline const char* decisionText(RiskDecision d) {
+    switch (d) {
+        case RiskDecision::PlayPositiveEV:
+            return "Play on: Positive expected value with favorable risk-reward ratio.";
+        case RiskDecision::AbortHighRisk:
+            return "Abort: High risk with significant potential loss.";
+        case RiskDecision::AbortInsufficientEV:
+            return "Abort: Negative or insufficient expected value.";
+        default:
+            return "Play on: Limited aborts left.";
+    }
+}
+
+// Thresholds of the model; the defaults are the values analyzeRisk has always
+// used.
+struct RiskParams {
+    double scalingNumerator; // scalingFactor = scalingNumerator / |rating difference|
+    double minGain;          // minimum acceptable gain, before scarcity
+    double maxLoss;          // maximum acceptable loss (negative), before scarcity
+    double riskRewardCutoff;
+
+    RiskParams() : scalingNumerator(250.0), minGain(5.0), maxLoss(-10.0), riskRewardCutoff(1.0) {}
+};
+
+// Belief over how many aborts the site still allows: uniform over
+// [minAborts, maxAborts] at the start, shifted down by one on every abort.
+class AbortBelief {
+public:
+    AbortBelief(int minAborts = 5, int maxAborts = 10)
+        : minAborts(minAborts),
+          prob(maxAborts - minAborts + 1, 1.0 / (maxAborts - minAborts + 1)), used(0) {}
+
+    // Belief after `aborts` recorded aborts.
+    static AbortBelief afterAborts(int aborts, int minAborts = 5, int maxAborts = 10) {
+        AbortBelief b(minAborts, maxAborts);
+        for (int i = 0; i < aborts; ++i) b.recordAbort();
+        return b;
+    }
+
+    // Number of abort counts still considered possible.
+    int possibleStates() const {
+        int n = 0;
+        for (double p : prob) {
+            if (p > 0) ++n;
+        }
+        return n;
+    }
+
+    double expectedAbortsLeft() const {
+        double expected = 0.0;
+        for (size_t i = 0; i < prob.size(); ++i) {
+            expected += prob[i] * (minAborts + static_cast<int>(i));
+        }
+        return expected;
+    }
+
+    void recordAbort() {
+        for (size_t i = 0; i + 1 < prob.size(); ++i) {
+            prob[i] = prob[i + 1];
+        }
+        if (!prob.empty()) prob.back() = 0.0;
+        ++used;
+    }
+
+    const std::vector<double>& probabilities() const { return prob; }
+    int abortsRecorded() const { return used; }
+
+    // Distinct beliefs reachable from the prior; every later abort leaves
+    // the belief all-zero, the same as the last state.
+    int stateCount() const { return static_cast<int>(prob.size()) + 1; }
+
+private:
+    int minAborts;
+    std::vector<double> prob;
+    int used;
+};
+
+struct RiskAssessment {
+    double expectedValue;
+    double riskRewardRatio;
+    double adjustedExpectedValue;
+    RiskDecision decision;
+};
+
+// Decision for already-computed EV terms and the abort belief summary. Batch
+// callers evaluate the EV columns themselves and share this.
+inline RiskDecision decideRisk(double playerRating, double win, double lose, double expected_value,
+                               double risk_reward_ratio, double adjusted_expected_value,
+                               int possibleAbortStates, double expected_aborts_left,
+                               const RiskParams& params = RiskParams()) {
+    // Scarcity factor adjustment
+    double scarcity_factor = 1.0;
+    if (expected_value < 0) {
+        scarcity_factor = 1.0 / possibleAbortStates;
+    }
+
+    // Adjust decision thresholds dynamically based on scarcity factor
+    double min_acceptable_gain = params.minGain * scarcity_factor;
+    double max_acceptable_loss = params.maxLoss / scarcity_factor;
+
+    if (adjusted_expected_value > 0 && risk_reward_ratio > params.riskRewardCutoff &&
+        win - playerRating > min_acceptable_gain) {
+        return RiskDecision::PlayPositiveEV;
+    } else if (lose - playerRating < max_acceptable_loss) {
+        return RiskDecision::AbortHighRisk;
+    } else if (expected_aborts_left > 0) {
+        return RiskDecision::AbortInsufficientEV;
+    }
+    return RiskDecision::PlayLimitedAborts;
+}
+
+// The parts of riskTerms that do not depend on RiskParams. Sweeps over the
+// parameters compute these once per pairing.
+struct RiskInputs {
+    double winGain, loseGain, drawGain; // outcome minus the player's rating
+    double winProb, loseProb, drawProb; // normalised, before scaling
+    double absDifference;               // |rating difference|
+    double riskRewardRatio;
+    double volatility;
+};
+
+// RD and RD_j are the (clamped) deviations the outcomes were computed with.
+inline RiskInputs riskInputs(double playerRating, double oppRating, double win, double lose, double draw,
+                             double RD, double RD_j) {
+    RiskInputs in;
+    // Calculate the rating difference
+    double ratingDifference = oppRating - playerRating;
+    in.absDifference = std::abs(ratingDifference);
+
+    // Bradley-Terry model for probability estimation
+    double win_prob = 1 / (1 + std::pow(10, ratingDifference / 400));
+    double lose_prob = 1 / (1 + std::pow(10, -ratingDifference / 400));
+    double draw_prob = 1 - win_prob - lose_prob;
+
+    // Normalize probabilities to sum to 1
+    double sum_probs = win_prob + lose_prob + draw_prob;
+    in.winProb = win_prob / sum_probs;
+    in.loseProb = lose_prob / sum_probs;
+    in.drawProb = draw_prob / sum_probs;
+
+    in.winGain = win - playerRating;
+    in.loseGain = lose - playerRating;
+    in.drawGain = draw - playerRating;
+
+    // Risk-reward analysis
+    in.riskRewardRatio = (win - playerRating) / (playerRating - lose);
+
+    // Volatility adjustment
+    in.volatility = std::sqrt(std::pow(RD, 2) + std::pow(RD_j, 2));
+    return in;
+}
+
+inline void riskTerms(const RiskInputs& in, const RiskParams& params, RiskAssessment& out) {
+    // Adjust the scaling factor based on the rating difference
+    double scalingFactor = params.scalingNumerator / in.absDifference;
+    double win_prob = in.winProb * scalingFactor;
+    double lose_prob = in.loseProb / scalingFactor;
+
+    // Calculate the expected value (EV)
+    out.expectedValue = in.winGain * win_prob + in.loseGain * lose_prob + in.drawGain * in.drawProb;
+    out.riskRewardRatio = in.riskRewardRatio;
+    out.adjustedExpectedValue = out.expectedValue / in.volatility;
+}
+
+// EV, risk-reward ratio and volatility-adjusted EV for one pairing.
+inline void riskTerms(double playerRating, double oppRating, double win, double lose, double draw,
+                      double RD, double RD_j, const RiskParams& params, RiskAssessment& out) {
+    riskTerms(riskInputs(playerRating, oppRating, win, lose, draw, RD, RD_j), params, out);
+}
+
+// analyzeRisk's evaluation for one pairing. The belief is not modified.
+inline RiskAssessment evaluateRisk(double playerRating, double oppRating, double win, double lose,
+                                   double draw, double RD, double RD_j, const AbortBelief& belief,
+                                   const RiskParams& params = RiskParams()) {
+    RiskAssessment out;
+    riskTerms(playerRating, oppRating, win, lose, draw, RD, RD_j, params, out);
+    out.decision = decideRisk(playerRating, win, lose, out.expectedValue, out.riskRewardRatio,
+                              out.adjustedExpectedValue, belief.possibleStates(),
+                              belief.expectedAbortsLeft(), params);
+    return out;
+}
+
+#endif // RISK_MODEL_H
@@ -0,0 +1,128 @@
+#ifndef RISK_SCREEN_H
+#define RISK_SCREEN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "Glicko.h"
+#include "GlickoBatch.h"
+#include "RiskModel.h"
+#include "SimdMath.h"
+
+// Column-oriented result of screening one player against N opponents.
+struct RiskColumns {
+    std::vector<double> win, lose, draw, newRD;
+    std::vector<double> expectedValue, riskRewardRatio, adjustedExpectedValue;
+    std::vector<RiskDecision> decision;
+
+    size_t size() const { return decision.size(); }
+
+    void resize(size_t n) {
+        win.resize(n);
+        lose.resize(n);
+        draw.resize(n);
+        newRD.resize(n);
+        expectedValue.resize(n);
+        riskRewardRatio.resize(n);
+        adjustedExpectedValue.resize(n);
+        decision.resize(n);
+    }
+};
+
+// Batch form of Game::calculateRatingRes + Game::analyzeRisk over a list of
+// candidate opponents. Every row is judged against the same abort belief (the
+// belief is not advanced between rows, since screening is hypothetical).
+//
+// Outcomes come from GlickoBatch::calculateOutcomes and the EV columns from an
+// AVX2 pass with the vector exp10, so a row can differ from analyzeRisk by a
+// few ulp in EV; decisions only differ for values sitting exactly on a
+// threshold.
+class RiskScreen {
+public:
+    static RiskColumns screen(double playerRating, double playerRD, const std::vector<double>& oppRating,
+                              const std::vector<double>& oppRD, const AbortBelief& belief,
+                              const RiskParams& params = RiskParams(),
+                              GlickoBatch::Path path = GlickoBatch::bestPath()) {
+        const size_t n = std::min(oppRating.size(), oppRD.size());
+        RiskColumns out;
+        out.resize(n);
+
+        // Same RD floor as calculateRatingRes.
+        const double RD = std::max(playerRD, kChessComRDFloor);
+        std::vector<double> r(n, playerRating), rd(n, RD), rdj(n);
+        for (size_t i = 0; i < n; ++i) {
+            rdj[i] = std::max(oppRD[i], kChessComRDFloor);
+        }
+        GlickoBatch::calculateOutcomes(r.data(), rd.data(), oppRating.data(), rdj.data(), out.win.data(),
+                                       out.lose.data(), out.draw.data(), out.newRD.data(), n, path);
+
+        size_t i = 0;
+#if CHESS_RATING_X86_SIMD
+        if (path != GlickoBatch::Scalar && simd::hasAVX2()) {
+            i = termsAVX2(playerRating, RD, oppRating.data(), rdj.data(), params, out, n);
+        }
+#endif
+        for (; i < n; ++i) {
+            RiskAssessment a;
+            riskTerms(playerRating, oppRating[i], out.win[i], out.lose[i], out.draw[i], RD, rdj[i], params, a);
+            out.expectedValue[i] = a.expectedValue;
+            out.riskRewardRatio[i] = a.riskRewardRatio;
+            out.adjustedExpectedValue[i] = a.adjustedExpectedValue;
+        }
+
+        const int states = belief.possibleStates();
+        const double abortsLeft = belief.expectedAbortsLeft();
+        for (size_t k = 0; k < n; ++k) {
+            out.decision[k] = decideRisk(playerRating, out.win[k], out.lose[k], out.expectedValue[k],
+                                         out.riskRewardRatio[k], out.adjustedExpectedValue[k], states,
+                                         abortsLeft, params);
+        }
+        return out;
+    }
+
+private:
+#if CHESS_RATING_X86_SIMD
+    // riskTerms for four opponents per vector.
+    __attribute__((target("avx2,fma")))
+    static size_t termsAVX2(double playerRating, double RD, const double* oppRating, const double* RD_j,
+                            const RiskParams& params, RiskColumns& out, size_t n) {
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d c400 = _mm256_set1_pd(400.0);
+        const __m256d pr = _mm256_set1_pd(playerRating);
+        const __m256d numer = _mm256_set1_pd(params.scalingNumerator);
+        const __m256d rd2 = _mm256_set1_pd(RD * RD);
+        const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d diff = _mm256_sub_pd(_mm256_loadu_pd(oppRating + i), pr);
+            __m256d scaling = _mm256_div_pd(numer, _mm256_and_pd(diff, absMask));
+
+            __m256d x = _mm256_div_pd(diff, c400);
+            __m256d winP = _mm256_div_pd(one, _mm256_add_pd(one, simd::exp10AVX2(x)));
+            __m256d loseP = _mm256_div_pd(one, _mm256_add_pd(one, simd::exp10AVX2(_mm256_sub_pd(_mm256_setzero_pd(), x))));
+            __m256d drawP = _mm256_sub_pd(_mm256_sub_pd(one, winP), loseP);
+            __m256d sum = _mm256_add_pd(_mm256_add_pd(winP, loseP), drawP);
+            winP = _mm256_mul_pd(_mm256_div_pd(winP, sum), scaling);
+            loseP = _mm256_div_pd(_mm256_div_pd(loseP, sum), scaling);
+            drawP = _mm256_div_pd(drawP, sum);
+
+            __m256d gain = _mm256_sub_pd(_mm256_loadu_pd(&out.win[i]), pr);
+            __m256d loss = _mm256_sub_pd(_mm256_loadu_pd(&out.lose[i]), pr);
+            __m256d drawDelta = _mm256_sub_pd(_mm256_loadu_pd(&out.draw[i]), pr);
+            __m256d ev = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(gain, winP), _mm256_mul_pd(loss, loseP)),
+                                       _mm256_mul_pd(drawDelta, drawP));
+            __m256d rr = _mm256_div_pd(gain, _mm256_sub_pd(_mm256_setzero_pd(), loss));
+
+            __m256d rdj = _mm256_loadu_pd(RD_j + i);
+            __m256d vol = _mm256_sqrt_pd(_mm256_add_pd(rd2, _mm256_mul_pd(rdj, rdj)));
+            _mm256_storeu_pd(&out.expectedValue[i], ev);
+            _mm256_storeu_pd(&out.riskRewardRatio[i], rr);
+            _mm256_storeu_pd(&out.adjustedExpectedValue[i], _mm256_div_pd(ev, vol));
+        }
+        return i;
+    }
+#endif
+};
+
+#endif // RISK_SCREEN_H
@@ -0,0 +1,336 @@
+#ifndef SESSION_DISTRIBUTION_H
+#define SESSION_DISTRIBUTION_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "FFT.h"
+#include "Glicko.h"
+#include "ParallelFor.h"
+#include "SessionSimulator.h"
+
+// Discrete opponent distribution. Offsets are relative to the player's rating
+// at the time of the pairing, as in SessionSimulator.
+struct OpponentPool {
+    std::vector<double> offset;
+    std::vector<double> RD;
+    std::vector<double> weight;
+
+    size_t size() const { return weight.size(); }
+
+    void add(double ratingOffset, double oppRD, double w) {
+        offset.push_back(ratingOffset);
+        RD.push_back(oppRD);
+        weight.push_back(w);
+    }
+
+    // SessionSimulator's pool: offset ~ N(mean, spread) cut at +-sigmas,
+    // RD ~ U[rdMin, rdMax] in rdBins buckets. Weights sum to 1.
+    static OpponentPool normal(double mean, double spread, double rdMin, double rdMax, double step = 10,
+                               int rdBins = 4, double sigmas = 4) {
+        OpponentPool pool;
+        const int half = spread > 0 ? static_cast<int>(std::lround(sigmas * spread / step)) : 0;
+        const double rdStep = (rdMax - rdMin) / std::max(rdBins, 1);
+        double sum = 0;
+        for (int k = -half; k <= half; ++k) {
+            double z = spread > 0 ? k * step / spread : 0;
+            double w = std::exp(-0.5 * z * z);
+            for (int b = 0; b < std::max(rdBins, 1); ++b) {
+                pool.add(mean + k * step, rdMin + (b + 0.5) * rdStep, w);
+                sum += w;
+            }
+        }
+        for (double& w : pool.weight) w /= sum;
+        return pool;
+    }
+};
+
+// Distribution of the net rating change, on a grid of `step` points:
+// p[i] is the probability of a change of (first + i) * step.
+struct RatingDistribution {
+    double step;
+    long first;
+    std::vector<double> p;
+
+    double change(size_t i) const { return (first + static_cast<long>(i)) * step; }
+
+    double mean() const {
+        double m = 0;
+        for (size_t i = 0; i < p.size(); ++i) m += p[i] * change(i);
+        return m;
+    }
+
+    double stddev() const {
+        double m = mean(), v = 0;
+        for (size_t i = 0; i < p.size(); ++i) v += p[i] * (change(i) - m) * (change(i) - m);
+        return std::sqrt(v);
+    }
+
+    // P(change <= x); probAtMost(-50) is the chance of dropping 50+ points.
+    double probAtMost(double x) const {
+        double sum = 0;
+        for (size_t i = 0; i < p.size() && change(i) <= x + 1e-9 * step; ++i) sum += p[i];
+        return sum;
+    }
+
+    // P(change >= x).
+    double probAtLeast(double x) const {
+        double sum = 0;
+        for (size_t i = p.size(); i-- > 0 && change(i) >= x - 1e-9 * step;) sum += p[i];
+        return sum;
+    }
+
+    // Smallest grid change c with P(change <= c) >= f.
+    double quantile(double f) const {
+        double sum = 0;
+        for (size_t i = 0; i < p.size(); ++i) {
+            sum += p[i];
+            if (sum >= f) return change(i);
+        }
+        return p.empty() ? 0 : change(p.size() - 1);
+    }
+};
+
+// Distribution of the rating after a number of games against an opponent
+// pool, by convolving the win/draw/loss deltas of calculateRatingRes on a
+// rating grid. A delta between grid points is split linearly between its two
+// neighbours, which keeps the mean exact.
+//
+// The player RD shrinks after every game as in SessionSimulator (clamped to
+// kChessComRDFloor when used). How much depends on the opponent but not on
+// the result, so it is followed along the pool-average path: each game adds
+// the pool's mean Glicko information q^2 g^2 E (1 - E) to 1/RD^2. That is
+// exact for a single-opponent pool and once RD is at the floor; otherwise
+// the per-game kernels differ slightly from a sampled opponent sequence.
+//
+// The Glicko delta depends only on the rating difference, so against a
+// relative pool the delta kernel is the same on every cell. The chance of
+// each result is drawn from the player's strength as in SessionSimulator:
+// either a fixed true rating, which pulls the rating back towards it, or a
+// strength that tracks the rating, which makes every game the same kernel.
+//
+//   direct() applies one game at a time with the result probabilities of each
+//            cell. Exact for the model, O(games * cells * pool).
+//   power()  multiplies the one-game kernels in the frequency domain, with
+//            one FFT per distinct RD and a power for the games at the floor,
+//            so O(N log N) per distinct RD for any number of games. Exact
+//            when the strength tracks the rating; with a fixed true rating it
+//            uses the starting probabilities throughout and so overstates the
+//            spread of long sessions. Values below ~1e-15 are FFT rounding.
+class SessionDistribution {
+public:
+    struct Config {
+        double playerRating;
+        double playerRD;
+        double trueRating;         // NaN = playerRating
+        bool strengthTracksRating; // ignore trueRating; results depend on the offset only
+        double drawRate;
+        double step;               // grid spacing in rating points
+        unsigned threads;          // 0 = all cores
+
+        Config()
+            : playerRating(1500), playerRD(60), trueRating(NAN), strengthTracksRating(false), drawRate(0.05),
+              step(1), threads(0) {}
+    };
+
+    static RatingDistribution direct(const Config& config, const OpponentPool& pool, int games) {
+        std::vector<Kernel> kernels = kernelsByGame(config, pool, games);
+        if (games <= 0) return trimmed(config.step, 0, std::vector<double>(1, 1.0));
+        long lo = 0, hi = 0;
+        for (int g = 0; g < games; ++g) {
+            lo += kernels[std::min<size_t>(g, kernels.size() - 1)].minCell;
+            hi += kernels[std::min<size_t>(g, kernels.size() - 1)].maxCell + 1;
+        }
+        const size_t n = static_cast<size_t>(hi - lo + 1);
+        const double trueRating = std::isnan(config.trueRating) ? config.playerRating : config.trueRating;
+
+        // E = 1 / (1 + 10^((x - T) / 400) * 10^(o / 400)): one factor per cell
+        // and one per opponent instead of a pow per pair.
+        const size_t m = pool.size();
+        std::vector<double> cellFactor(n, 1.0), oppFactor(m);
+        if (!config.strengthTracksRating) {
+            for (size_t c = 0; c < n; ++c) {
+                double rating = config.playerRating + (static_cast<long>(c) + lo) * config.step;
+                cellFactor[c] = std::pow(10, (rating - trueRating) / 400);
+            }
+        }
+        for (size_t j = 0; j < m; ++j) oppFactor[j] = std::pow(10, pool.offset[j] / 400);
+
+        std::vector<double> cur(n, 0.0), next(n);
+        cur[static_cast<size_t>(-lo)] = 1.0;
+        long supportLo = 0, supportHi = 0; // in cells relative to the start
+
+        const unsigned threads = workerCount(config.threads);
+        std::vector<std::vector<double>> partial(threads, std::vector<double>(n));
+
+        for (int g = 0; g < games; ++g) {
+            const Kernel& k = kernels[std::min<size_t>(g, kernels.size() - 1)];
+            const long newLo = supportLo + k.minCell, newHi = supportHi + k.maxCell + 1;
+            for (std::vector<double>& buf : partial) {
+                std::fill(buf.begin() + (newLo - lo), buf.begin() + (newHi - lo + 1), 0.0);
+            }
+            parallelFor(static_cast<size_t>(supportLo - lo), static_cast<size_t>(supportHi - lo + 1), 64,
+                        [&](size_t from, size_t to, unsigned worker) {
+                double* out = partial[worker].data();
+                for (size_t c = from; c < to; ++c) {
+                    const double mass = cur[c];
+                    if (mass == 0) continue;
+                    for (size_t j = 0; j < m; ++j) {
+                        double pWin, pDraw, pLose;
+                        SessionSimulator::splitExpectedScore(1 / (1 + cellFactor[c] * oppFactor[j]), config.drawRate,
+                                                             pWin, pDraw, pLose);
+                        const double w = mass * pool.weight[j];
+                        spread(out, c, k.win[j], w * pWin);
+                        spread(out, c, k.draw[j], w * pDraw);
+                        spread(out, c, k.lose[j], w * pLose);
+                    }
+                }
+            }, threads);
+
+            std::fill(next.begin(), next.end(), 0.0);
+            for (const std::vector<double>& buf : partial) {
+                for (long c = newLo; c <= newHi; ++c) next[c - lo] += buf[c - lo];
+            }
+            cur.swap(next);
+            supportLo = newLo;
+            supportHi = newHi;
+        }
+        return trimmed(config.step, lo, cur);
+    }
+
+    static RatingDistribution power(const Config& config, const OpponentPool& pool, int games) {
+        std::vector<Kernel> kernels = kernelsByGame(config, pool, games);
+        if (games <= 0) return trimmed(config.step, 0, std::vector<double>(1, 1.0));
+        const double trueRating = std::isnan(config.trueRating) ? config.playerRating : config.trueRating;
+
+        // Game g uses kernels[g]; the last kernel repeats for the rest.
+        const int distinct = std::min<int>(games, static_cast<int>(kernels.size()));
+        const int repeats = games - distinct + 1;
+        long first = 0;
+        size_t total = 1;
+        for (int g = 0; g < distinct; ++g) {
+            const int count = g + 1 == distinct ? repeats : 1;
+            first += count * kernels[g].minCell;
+            total += static_cast<size_t>(count) * (kernels[g].maxCell + 1 - kernels[g].minCell);
+        }
+
+        const size_t N = fftSize(total);
+        std::vector<std::complex<double>> f(N, 1.0), z(N);
+        for (int g = 0; g < distinct; ++g) {
+            // One-game kernel, shifted so that its lowest cell is index 0.
+            const Kernel& k = kernels[g];
+            std::vector<double> one(static_cast<size_t>(k.maxCell + 1 - k.minCell) + 1, 0.0);
+            for (size_t j = 0; j < pool.size(); ++j) {
+                double pWin, pDraw, pLose;
+                SessionSimulator::resultProbabilities(config.strengthTracksRating ? config.playerRating : trueRating,
+                                                      config.playerRating + pool.offset[j], config.drawRate, pWin,
+                                                      pDraw, pLose);
+                const size_t base = static_cast<size_t>(-k.minCell);
+                spread(one.data(), base, k.win[j], pool.weight[j] * pWin);
+                spread(one.data(), base, k.draw[j], pool.weight[j] * pDraw);
+                spread(one.data(), base, k.lose[j], pool.weight[j] * pLose);
+            }
+            std::fill(z.begin(), z.end(), 0.0);
+            std::copy(one.begin(), one.end(), z.begin());
+            fft(z);
+            const int count = g + 1 == distinct ? repeats : 1;
+            for (size_t i = 0; i < N; ++i) f[i] *= powi(z[i], count);
+        }
+        fft(f, true);
+
+        std::vector<double> p(total);
+        for (size_t i = 0; i < total; ++i) p[i] = std::max(0.0, f[i].real());
+        return trimmed(config.step, first, p);
+    }
+
+private:
+    // Where one outcome delta lands: `cell` whole cells up, then `frac` of
+    // the mass one cell further.
+    struct Landing {
+        long cell;
+        double frac;
+    };
+
+    struct Kernel {
+        std::vector<Landing> win, draw, lose;
+        long minCell, maxCell; // range of Landing::cell
+    };
+
+    // Kernel of every game until the player RD reaches the floor; the last
+    // one applies to the remaining games.
+    static std::vector<Kernel> kernelsByGame(const Config& config, const OpponentPool& pool, int games) {
+        if (config.step <= 0 || pool.size() == 0) {
+            throw std::invalid_argument("SessionDistribution: empty pool or invalid grid step");
+        }
+        std::vector<Kernel> kernels;
+        double RD = config.playerRD;
+        for (int g = 0; g < std::max(games, 1); ++g) {
+            const double used = std::max(RD, kChessComRDFloor);
+            kernels.push_back(kernel(config, pool, used));
+            if (used == kChessComRDFloor) break;
+            double info = 0;
+            for (size_t j = 0; j < pool.size(); ++j) {
+                GlickoTerms t(config.playerRating, used, config.playerRating + pool.offset[j],
+                              std::max(pool.RD[j], kChessComRDFloor));
+                info += pool.weight[j] * (t.denom - 1 / (used * used));
+            }
+            RD = std::sqrt(1 / (1 / (used * used) + info));
+        }
+        return kernels;
+    }
+
+    static Kernel kernel(const Config& config, const OpponentPool& pool, double RD) {
+        Kernel k;
+        k.minCell = 0;
+        k.maxCell = 0;
+        auto landing = [&](double delta) {
+            double u = delta / config.step;
+            Landing l;
+            l.cell = static_cast<long>(std::floor(u));
+            l.frac = u - l.cell;
+            k.minCell = std::min(k.minCell, l.cell);
+            k.maxCell = std::max(k.maxCell, l.cell);
+            return l;
+        };
+        for (size_t j = 0; j < pool.size(); ++j) {
+            const double r = config.playerRating;
+            RatingOutcomes o = glickoOutcomes(r, RD, r + pool.offset[j], std::max(pool.RD[j], kChessComRDFloor));
+            k.win.push_back(landing(o.win - r));
+            k.draw.push_back(landing(o.draw - r));
+            k.lose.push_back(landing(o.lose - r));
+        }
+        return k;
+    }
+
+    static void spread(double* out, size_t c, const Landing& l, double mass) {
+        out[c + l.cell] += mass * (1 - l.frac);
+        out[c + l.cell + 1] += mass * l.frac;
+    }
+
+    static std::complex<double> powi(std::complex<double> z, int n) {
+        std::complex<double> result(1.0, 0.0);
+        while (n > 0) {
+            if (n & 1) result *= z;
+            z *= z;
+            n >>= 1;
+        }
+        return result;
+    }
+
+    // Drops the zero cells at either end.
+    static RatingDistribution trimmed(double step, long first, const std::vector<double>& p) {
+        size_t a = 0, b = p.size();
+        while (a < b && p[a] == 0) ++a;
+        while (b > a && p[b - 1] == 0) --b;
+        RatingDistribution d;
+        d.step = step;
+        d.first = first + static_cast<long>(a);
+        d.p.assign(p.begin() + a, p.begin() + b);
+        return d;
+    }
+};
+
+#endif // SESSION_DISTRIBUTION_H
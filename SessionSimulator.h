@@ -0,0 +1,264 @@
+#ifndef SESSION_SIMULATOR_H
+#define SESSION_SIMULATOR_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "Glicko.h"
+#include "ParallelFor.h"
+#include "RiskModel.h"
+
+// splitmix64: small, fast and good enough for simulation. Each session gets
+// its own generator seeded from (seed, session index), so a run gives the
+// same numbers whatever the thread count or scheduling.
+struct SplitMix64 {
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed = 0) : state(seed) {}
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    static SplitMix64 forStream(uint64_t seed, uint64_t stream) {
+        return SplitMix64(mix(seed + 0x9e3779b97f4a7c15ULL * (stream + 1)));
+    }
+
+    uint64_t next() {
+        state += 0x9e3779b97f4a7c15ULL;
+        return mix(state);
+    }
+
+    // Uniform in [0, 1).
+    double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Uniform integer in [lo, hi].
+    int range(int lo, int hi) {
+        return lo + static_cast<int>(next() % static_cast<uint64_t>(hi - lo + 1));
+    }
+
+    // Standard normal (Box-Muller, one value per call).
+    double normal() {
+        double u = 1.0 - uniform();
+        double v = uniform();
+        return std::sqrt(-2.0 * std::log(u)) * std::cos(2 * pi * v);
+    }
+};
+
+// One pairing as the policy sees it: the clamped RDs and the outcomes
+// Game::calculateRatingRes would show, plus where the session stands.
+struct SessionPairing {
+    double playerRating;
+    double playerRD;
+    double oppRating;
+    double oppRD;
+    RatingOutcomes outcomes;
+    int pairingsLeft;     // including this one
+    bool abortsExhausted; // an abort has already been refused this session
+};
+
+// The analyzeRisk policy.
+struct AnalyzeRiskPolicy {
+    RiskParams params;
+
+    bool operator()(const SessionPairing& p, const AbortBelief& belief) const {
+        RiskAssessment a = evaluateRisk(p.playerRating, p.oppRating, p.outcomes.win, p.outcomes.lose,
+                                        p.outcomes.draw, p.playerRD, p.oppRD, belief, params);
+        return isAbort(a.decision);
+    }
+};
+
+// Never aborts; the baseline a policy has to beat.
+struct AlwaysPlayPolicy {
+    bool operator()(const SessionPairing&, const AbortBelief&) const { return false; }
+};
+
+// Monte Carlo bullet sessions. A session is a run of pairings against
+// opponents drawn from the pool; on each pairing the policy either plays (the
+// result is drawn from the player's true strength and the rating moves as in
+// Game) or aborts. The site's real abort allowance is drawn per session from
+// [minAborts, maxAborts], the range AbortBelief assumes; an abort beyond it is
+// refused and scored as a forfeit loss.
+class SessionSimulator {
+public:
+    struct Config {
+        double playerRating;
+        double playerRD;
+        double trueRating;    // strength results are drawn from; NaN = playerRating
+        int pairingsPerSession;
+        double oppMeanOffset; // opponent rating ~ N(player + offset, spread)
+        double oppSpread;
+        double oppRDMin;      // opponent RD ~ U[oppRDMin, oppRDMax]
+        double oppRDMax;
+        double drawRate;
+        int minAborts;
+        int maxAborts;
+        uint64_t seed;
+        unsigned threads;     // 0 = all cores
+
+        Config()
+            : playerRating(1500), playerRD(60), trueRating(NAN), pairingsPerSession(50), oppMeanOffset(0),
+              oppSpread(150), oppRDMin(55), oppRDMax(150), drawRate(0.05), minAborts(5), maxAborts(10),
+              seed(1), threads(0) {}
+    };
+
+    struct Report {
+        size_t sessions;
+        size_t pairings;
+        size_t played;
+        size_t aborts;
+        size_t forfeits;
+        double meanChange;
+        double stddevChange;
+        double minChange;
+        double maxChange;
+        double p5, p25, p50, p75, p95;
+        double seconds;
+        double pairingsPerSecond;
+    };
+
+    // Runs `sessions` sessions and returns the distribution of net rating
+    // change per session. If `changes` is given it receives every session's
+    // net change, in session order.
+    template <class Policy>
+    static Report run(size_t sessions, const Config& config, Policy policy,
+                      std::vector<double>* changes = nullptr) {
+        if (config.pairingsPerSession <= 0 || config.minAborts > config.maxAborts) {
+            throw std::invalid_argument("SessionSimulator: invalid session configuration");
+        }
+
+        std::vector<double> net(sessions);
+        const unsigned threads = workerCount(config.threads);
+        std::vector<Counts> counts(threads);
+
+        auto start = std::chrono::steady_clock::now();
+        parallelFor(0, sessions, 256, [&](size_t lo, size_t hi, unsigned worker) {
+            Counts& c = counts[worker];
+            for (size_t k = lo; k < hi; ++k) {
+                net[k] = simulateSession(config, policy, SplitMix64::forStream(config.seed, k), c);
+            }
+        }, threads);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Report report = Report();
+        report.sessions = sessions;
+        report.pairings = sessions * static_cast<size_t>(config.pairingsPerSession);
+        for (const Counts& c : counts) {
+            report.played += c.played;
+            report.aborts += c.aborts;
+            report.forfeits += c.forfeits;
+        }
+        report.seconds = seconds;
+        report.pairingsPerSecond = seconds > 0 ? report.pairings / seconds : 0;
+        summarize(net, report);
+
+        if (changes) changes->swap(net);
+        return report;
+    }
+
+    static Report run(size_t sessions, const Config& config = Config()) {
+        return run(sessions, config, AnalyzeRiskPolicy());
+    }
+
+    // Result model: the expected score of the true strength against the
+    // opponent's displayed rating, with a fixed share of draws.
+    static void resultProbabilities(double trueRating, double oppRating, double drawRate, double& pWin,
+                                    double& pDraw, double& pLose) {
+        splitExpectedScore(1 / (1 + std::pow(10, -(trueRating - oppRating) / 400)), drawRate, pWin, pDraw, pLose);
+    }
+
+    static void splitExpectedScore(double E, double drawRate, double& pWin, double& pDraw, double& pLose) {
+        pDraw = std::min(drawRate, 2 * std::min(E, 1 - E));
+        pWin = E - pDraw / 2;
+        pLose = 1 - pWin - pDraw;
+    }
+
+private:
+    struct Counts {
+        size_t played = 0, aborts = 0, forfeits = 0;
+        char pad[64]; // one per worker; keep them off each other's cache line
+    };
+
+    template <class Policy>
+    static double simulateSession(const Config& config, const Policy& policy, SplitMix64 rng, Counts& c) {
+        const double trueRating = std::isnan(config.trueRating) ? config.playerRating : config.trueRating;
+        double rating = config.playerRating;
+        double RD = config.playerRD;
+        AbortBelief belief(config.minAborts, config.maxAborts);
+        int allowance = rng.range(config.minAborts, config.maxAborts);
+        bool exhausted = false;
+
+        for (int game = 0; game < config.pairingsPerSession; ++game) {
+            SessionPairing p;
+            p.playerRating = rating;
+            p.playerRD = std::max(RD, kChessComRDFloor);
+            p.oppRating = std::round(rating + config.oppMeanOffset + config.oppSpread * rng.normal());
+            p.oppRD = std::max(std::round(config.oppRDMin + (config.oppRDMax - config.oppRDMin) * rng.uniform()),
+                               kChessComRDFloor);
+            p.outcomes = glickoOutcomes(p.playerRating, p.playerRD, p.oppRating, p.oppRD);
+            p.pairingsLeft = config.pairingsPerSession - game;
+            p.abortsExhausted = exhausted;
+
+            double u = rng.uniform();
+            if (policy(p, belief)) {
+                belief.recordAbort();
+                if (allowance > 0) {
+                    --allowance;
+                    ++c.aborts;
+                    continue;
+                }
+                ++c.forfeits;
+                exhausted = true;
+                rating = p.outcomes.lose;
+                RD = p.outcomes.newRD;
+                continue;
+            }
+
+            double pWin, pDraw, pLose;
+            resultProbabilities(trueRating, p.oppRating, config.drawRate, pWin, pDraw, pLose);
+            ++c.played;
+            if (u < pWin) {
+                rating = p.outcomes.win;
+            } else if (u < pWin + pDraw) {
+                rating = p.outcomes.draw;
+            } else {
+                rating = p.outcomes.lose;
+            }
+            RD = p.outcomes.newRD;
+        }
+        return rating - config.playerRating;
+    }
+
+    static void summarize(const std::vector<double>& net, Report& report) {
+        if (net.empty()) return;
+        double sum = 0, sumSq = 0;
+        for (double x : net) {
+            sum += x;
+            sumSq += x * x;
+        }
+        const double n = static_cast<double>(net.size());
+        report.meanChange = sum / n;
+        report.stddevChange = std::sqrt(std::max(0.0, sumSq / n - report.meanChange * report.meanChange));
+
+        std::vector<double> sorted(net);
+        std::sort(sorted.begin(), sorted.end());
+        auto quantile = [&](double f) { return sorted[static_cast<size_t>(f * (sorted.size() - 1))]; };
+        report.minChange = sorted.front();
+        report.maxChange = sorted.back();
+        report.p5 = quantile(0.05);
+        report.p25 = quantile(0.25);
+        report.p50 = quantile(0.50);
+        report.p75 = quantile(0.75);
+        report.p95 = quantile(0.95);
+    }
+};
+
+#endif // SESSION_SIMULATOR_H
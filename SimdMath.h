@@ -0,0 +1,129 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+// Vector exp/exp10 for the batch kernels. The AVX2 and AVX-512 bodies are
+// compiled with per-function target attributes, so the rest of the program
+// keeps the baseline ISA and the caller picks a path at runtime.
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CHESS_RATING_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define CHESS_RATING_X86_SIMD 0
+#endif
+
+namespace simd {
+
+// ln(10) and ln(2) split into a head and a tail so the argument reduction
+// keeps ~100 bits of the constant.
+const double kLn10Hi = 2.302585092994046;
+const double kLn10Lo = -2.17075622338224935e-16;
+const double kLn2Hi = 6.93147180369123816490e-01;
+const double kLn2Lo = 1.90821492927058770002e-10;
+const double kLog2e = 1.4426950408889634;
+// Beyond these the result is 0 / inf in double anyway.
+const double kExpMin = -708.0;
+const double kExpMax = 709.0;
+
+// Taylor coefficients 1/k! for k = 13..2, highest first. The reduced argument
+// satisfies |x| <= ln(2)/2 so the truncation error is below 1e-17.
+const double kExpPoly[] = {
+    1.6059043836821613e-10, 2.0876756987868100e-09, 2.5052108385441720e-08,
+    2.7557319223985893e-07, 2.7557319223985888e-06, 2.4801587301587302e-05,
+    1.9841269841269841e-04, 1.3888888888888889e-03, 8.3333333333333332e-03,
+    4.1666666666666664e-02, 1.6666666666666666e-01, 5.0000000000000000e-01,
+};
+const int kExpPolyLen = sizeof(kExpPoly) / sizeof(kExpPoly[0]);
+
+inline bool hasAVX2() {
+#if CHESS_RATING_X86_SIMD
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+inline bool hasAVX512() {
+#if CHESS_RATING_X86_SIMD
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+}
+
+#if CHESS_RATING_X86_SIMD
+
+// e^(hi + lo) for four lanes; lo carries the rounding error of hi.
+__attribute__((target("avx2,fma")))
+inline __m256d expAVX2(__m256d hi, __m256d lo) {
+    hi = _mm256_max_pd(_mm256_min_pd(hi, _mm256_set1_pd(kExpMax)), _mm256_set1_pd(kExpMin));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(hi, _mm256_set1_pd(kLog2e)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d x = _mm256_fnmadd_pd(n, _mm256_set1_pd(kLn2Hi), hi);
+    x = _mm256_fnmadd_pd(n, _mm256_set1_pd(kLn2Lo), x);
+    x = _mm256_add_pd(x, lo);
+
+    __m256d p = _mm256_set1_pd(kExpPoly[0]);
+    for (int i = 1; i < kExpPolyLen; ++i) {
+        p = _mm256_fmadd_pd(p, x, _mm256_set1_pd(kExpPoly[i]));
+    }
+    // e^x = 1 + x + x^2 * p(x)
+    p = _mm256_fmadd_pd(_mm256_mul_pd(x, x), p, x);
+    p = _mm256_add_pd(p, _mm256_set1_pd(1.0));
+
+    // Scale by 2^n by adding n to the exponent field.
+    __m256i k = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+    k = _mm256_slli_epi64(_mm256_add_epi64(k, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(k));
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256d expAVX2(__m256d x) {
+    return expAVX2(x, _mm256_setzero_pd());
+}
+
+// 10^y, with y * ln(10) carried in double-double before the reduction.
+__attribute__((target("avx2,fma")))
+inline __m256d exp10AVX2(__m256d y) {
+    __m256d hi = _mm256_mul_pd(y, _mm256_set1_pd(kLn10Hi));
+    __m256d lo = _mm256_fmsub_pd(y, _mm256_set1_pd(kLn10Hi), hi);
+    lo = _mm256_fmadd_pd(y, _mm256_set1_pd(kLn10Lo), lo);
+    return expAVX2(hi, lo);
+}
+
+__attribute__((target("avx512f")))
+inline __m512d expAVX512(__m512d hi, __m512d lo) {
+    hi = _mm512_max_pd(_mm512_min_pd(hi, _mm512_set1_pd(kExpMax)), _mm512_set1_pd(kExpMin));
+    __m512d n = _mm512_roundscale_pd(_mm512_mul_pd(hi, _mm512_set1_pd(kLog2e)),
+                                     _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d x = _mm512_fnmadd_pd(n, _mm512_set1_pd(kLn2Hi), hi);
+    x = _mm512_fnmadd_pd(n, _mm512_set1_pd(kLn2Lo), x);
+    x = _mm512_add_pd(x, lo);
+
+    __m512d p = _mm512_set1_pd(kExpPoly[0]);
+    for (int i = 1; i < kExpPolyLen; ++i) {
+        p = _mm512_fmadd_pd(p, x, _mm512_set1_pd(kExpPoly[i]));
+    }
+    p = _mm512_fmadd_pd(_mm512_mul_pd(x, x), p, x);
+    p = _mm512_add_pd(p, _mm512_set1_pd(1.0));
+    return _mm512_scalef_pd(p, n);
+}
+
+__attribute__((target("avx512f")))
+inline __m512d expAVX512(__m512d x) {
+    return expAVX512(x, _mm512_setzero_pd());
+}
+
+__attribute__((target("avx512f")))
+inline __m512d exp10AVX512(__m512d y) {
+    __m512d hi = _mm512_mul_pd(y, _mm512_set1_pd(kLn10Hi));
+    __m512d lo = _mm512_fmsub_pd(y, _mm512_set1_pd(kLn10Hi), hi);
+    lo = _mm512_fmadd_pd(y, _mm512_set1_pd(kLn10Lo), lo);
+    return expAVX512(hi, lo);
+}
+
+#endif // CHESS_RATING_X86_SIMD
+
+} // namespace simd
+
+#endif // SIMD_MATH_H
@@ -0,0 +1,355 @@
+#ifndef STATS_CACHE_H
+#define STATS_CACHE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "StatsExtractor.h"
+
+// Persistent username -> PlayerStats cache in a memory-mapped file.
+//
+// The file is a header followed by a power-of-two array of fixed 128-byte
+// records, and the array is itself the hash index: a username hashes to a
+// slot and collisions probe linearly. Opening the cache is an mmap and a
+// header check; nothing is parsed, and a lookup touches one or two records
+// whatever the number of players. The table doubles (into a new file that
+// is renamed over the old one) once it is 70% full, so a few hundred
+// thousand players take tens of megabytes.
+//
+// Every mode of a player is stored together, as they come from one /stats
+// response, with the time of that fetch. Entries older than `ttlSeconds` are
+// still returned but flagged stale, so a caller can show them at once and
+// refresh in the background. Usernames are case-insensitive, as on
+// Chess.com; names too long for a record are simply not cached.
+//
+// Thread-safe within a process. The file is not locked, so two processes
+// should not write the same cache at once. An empty path keeps the table in
+// anonymous memory, for when no cache file can be written.
+class StatsCache {
+public:
+    struct Config {
+        int64_t ttlSeconds;
+        size_t initialCapacity; // slots, rounded up to a power of two
+
+        Config() : ttlSeconds(6 * 3600), initialCapacity(4096) {}
+    };
+
+    struct Entry {
+        PlayerStats stats;
+        int64_t fetchedAt; // unix seconds
+        bool stale;        // older than ttlSeconds
+    };
+
+    explicit StatsCache(const std::string& path, const Config& config = Config())
+        : path(path), config(config), header(nullptr), records(nullptr), mapped(0) {
+        if (path.empty()) {
+            map(-1, fileSize(roundUp(config.initialCapacity)));
+            initHeader(roundUp(config.initialCapacity));
+            return;
+        }
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) throw std::runtime_error("StatsCache: cannot open " + path + ": " + std::strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("StatsCache: cannot stat " + path);
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        bool fresh = size < sizeof(Header);
+        if (!fresh) {
+            map(fd, size);
+            fresh = !valid(size);
+            if (fresh) {
+                std::cerr << "Error: StatsCache: discarding unrecognised cache file " << path << std::endl;
+                unmap();
+            }
+        }
+        if (fresh) {
+            const size_t capacity = roundUp(config.initialCapacity);
+            size = fileSize(capacity);
+            if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                ::close(fd);
+                throw std::runtime_error("StatsCache: cannot size " + path);
+            }
+            map(fd, size);
+            initHeader(capacity);
+        }
+        ::close(fd); // the mapping keeps the file open
+    }
+
+    ~StatsCache() {
+        if (header && !path.empty()) msync(header, mapped, MS_ASYNC);
+        unmap();
+    }
+
+    StatsCache(const StatsCache&) = delete;
+    StatsCache& operator=(const StatsCache&) = delete;
+
+    // Default cache file: $XDG_CACHE_HOME or ~/.cache, else the working
+    // directory.
+    static std::string defaultPath() {
+        std::string dir;
+        if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+            dir = xdg;
+        } else if (const char* home = std::getenv("HOME")) {
+            dir = std::string(home) + "/.cache";
+        }
+        if (!dir.empty()) {
+            ::mkdir(dir.c_str(), 0755); // usually exists already
+            return dir + "/chess-rating-stats.cache";
+        }
+        return "chess-rating-stats.cache";
+    }
+
+    bool lookup(const std::string& username, Entry& out) const {
+        Key key;
+        if (!makeKey(username, key)) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        const Record* r = find(key);
+        if (!r || !r->used) return false;
+        for (int m = 0; m < PlayerStats::kModes; ++m) {
+            out.stats.modes[m].found = (r->foundMask >> m) & 1;
+            out.stats.modes[m].rating = r->rating[m];
+            out.stats.modes[m].rd = r->rd[m];
+        }
+        out.fetchedAt = r->fetchedAt;
+        out.stale = now() - r->fetchedAt > config.ttlSeconds;
+        return true;
+    }
+
+    // Inserts or replaces the entry for `username`.
+    void store(const std::string& username, const PlayerStats& stats, int64_t fetchedAt = now()) {
+        Key key;
+        if (!makeKey(username, key)) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        Record* r = find(key);
+        if (!r->used) {
+            if (10 * (header->count + 1) > 7 * header->capacity) {
+                grow();
+                r = find(key);
+            }
+            ++header->count;
+        }
+        r->hash = key.hash;
+        std::memcpy(r->name, key.name, sizeof(r->name));
+        r->fetchedAt = fetchedAt;
+        r->foundMask = 0;
+        for (int m = 0; m < PlayerStats::kModes; ++m) {
+            r->foundMask |= (stats[m].found ? 1u : 0u) << m;
+            r->rating[m] = stats[m].rating;
+            r->rd[m] = stats[m].rd;
+        }
+        r->used = 1;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<size_t>(header->count);
+    }
+
+    size_t capacity() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<size_t>(header->capacity);
+    }
+
+    int64_t ttl() const { return config.ttlSeconds; }
+
+    // Writes dirty pages back now instead of whenever the kernel gets to it.
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!path.empty()) msync(header, mapped, MS_SYNC);
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+private:
+    static const uint32_t kVersion = 1;
+    static const size_t kNameBytes = 40; // Chess.com usernames are at most 25
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint64_t capacity;
+        uint64_t count;
+        char reserved[32];
+    };
+
+    struct Record {
+        uint64_t hash;
+        char name[kNameBytes]; // lowercased, NUL-padded
+        int64_t fetchedAt;
+        int32_t rating[PlayerStats::kModes];
+        int32_t rd[PlayerStats::kModes];
+        uint8_t used;
+        uint8_t foundMask; // bit m: modes[m].found
+        char reserved[30];
+    };
+
+    static_assert(sizeof(Header) == 64, "StatsCache header layout changed");
+    static_assert(sizeof(Record) == 128, "StatsCache record layout changed");
+
+    struct Key {
+        uint64_t hash;
+        char name[kNameBytes];
+    };
+
+    std::string path;
+    Config config;
+    mutable std::mutex mutex;
+    Header* header;
+    Record* records;
+    size_t mapped;
+
+    static bool makeKey(const std::string& username, Key& key) {
+        if (username.empty() || username.size() >= kNameBytes) return false;
+        std::memset(key.name, 0, sizeof(key.name));
+        uint64_t h = 14695981039346656037ULL; // FNV-1a
+        for (size_t i = 0; i < username.size(); ++i) {
+            char c = static_cast<char>(std::tolower(static_cast<unsigned char>(username[i])));
+            key.name[i] = c;
+            h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        key.hash = h;
+        return true;
+    }
+
+    // Slot holding `key`, or the empty slot where it would go.
+    Record* find(const Key& key) const {
+        const uint64_t mask = header->capacity - 1;
+        for (uint64_t i = key.hash & mask;; i = (i + 1) & mask) {
+            Record* r = &records[i];
+            if (!r->used) return r;
+            if (r->hash == key.hash && std::memcmp(r->name, key.name, kNameBytes) == 0) return r;
+        }
+    }
+
+    static size_t roundUp(size_t n) {
+        size_t c = 16;
+        while (c < n) c <<= 1;
+        return c;
+    }
+
+    static size_t fileSize(size_t capacity) { return sizeof(Header) + capacity * sizeof(Record); }
+
+    bool valid(size_t size) const {
+        const uint64_t capacity = header->capacity;
+        return std::memcmp(header->magic, "CRSTATS", 8) == 0 && header->version == kVersion &&
+               header->recordSize == sizeof(Record) && capacity >= 16 && (capacity & (capacity - 1)) == 0 &&
+               size == fileSize(static_cast<size_t>(capacity)) && header->count < capacity;
+    }
+
+    void initHeader(size_t capacity) {
+        std::memset(header, 0, sizeof(Header));
+        std::memcpy(header->magic, "CRSTATS", 8);
+        header->version = kVersion;
+        header->recordSize = sizeof(Record);
+        header->capacity = capacity;
+        header->count = 0;
+    }
+
+    // fd < 0 maps anonymous memory.
+    void map(int fd, size_t size) {
+        void* p = fd < 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                         : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error(std::string("StatsCache: mmap failed: ") + std::strerror(errno));
+        }
+        header = static_cast<Header*>(p);
+        records = reinterpret_cast<Record*>(static_cast<char*>(p) + sizeof(Header));
+        mapped = size;
+    }
+
+    void unmap() {
+        if (header) munmap(header, mapped);
+        header = nullptr;
+        records = nullptr;
+        mapped = 0;
+    }
+
+    // Rehashes into a table twice the size. On disk the new table is built
+    // in a side file and renamed over the old one, so a crash mid-way leaves
+    // the previous file intact.
+    void grow() {
+        const size_t capacity = static_cast<size_t>(header->capacity) * 2;
+        const size_t size = fileSize(capacity);
+        Header* oldHeader = header;
+        Record* oldRecords = records;
+        const size_t oldMapped = mapped;
+
+        const std::string tmp = path + ".tmp";
+        int fd = -1;
+        if (!path.empty()) {
+            fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) throw std::runtime_error("StatsCache: cannot create " + tmp);
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                ::close(fd);
+                throw std::runtime_error("StatsCache: cannot size " + tmp);
+            }
+        }
+        try {
+            map(fd, size);
+        } catch (...) {
+            header = oldHeader;
+            records = oldRecords;
+            mapped = oldMapped;
+            throw;
+        }
+        if (fd >= 0) ::close(fd);
+        initHeader(capacity);
+        for (uint64_t i = 0; i < oldHeader->capacity; ++i) {
+            const Record& r = oldRecords[i];
+            if (!r.used) continue;
+            Key key;
+            key.hash = r.hash;
+            std::memcpy(key.name, r.name, kNameBytes);
+            *find(key) = r;
+        }
+        header->count = oldHeader->count;
+        munmap(oldHeader, oldMapped);
+        if (path.empty()) return;
+        // The new table has to be on disk before the rename makes it the
+        // cache, and the directory after, so the rename survives a power loss.
+        if (msync(header, mapped, MS_SYNC) != 0) {
+            std::cerr << "Error: StatsCache: cannot sync " << tmp << "; " << path << " is left as it was"
+                      << std::endl;
+            return;
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::cerr << "Error: StatsCache: cannot replace " << path << std::endl;
+            return;
+        }
+        syncDir();
+    }
+
+    void syncDir() const {
+        const size_t slash = path.rfind('/');
+        const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0 || ::fsync(fd) != 0) {
+            std::cerr << "Error: StatsCache: cannot sync " << dir << std::endl;
+        }
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+#endif // STATS_CACHE_H
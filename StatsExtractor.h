@@ -0,0 +1,281 @@
+#ifndef STATS_EXTRACTOR_H
+#define STATS_EXTRACTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+// Rating and RD of one time control, as found in a /stats response.
+struct ModeStats {
+    int rating;
+    int rd;
+    bool found;
+
+    ModeStats() : rating(0), rd(0), found(false) {}
+};
+
+// Pulls <mode>.last.rating and <mode>.last.rd for a set of modes out of a
+// /stats response with nlohmann's SAX interface, without building the json
+// tree. The handler keeps one small path record per nesting level and
+// compares keys in place, so it allocates nothing per key or value; parsing
+// stops as soon as every requested field has been seen.
+class StatsExtractor {
+public:
+    explicit StatsExtractor(std::vector<std::string> modes) : modes(std::move(modes)) {}
+
+    const std::vector<std::string>& modeNames() const { return modes; }
+
+    // Fills out[i] for modes[i]. Returns false if the body is not valid JSON
+    // (up to the point where everything needed was found).
+    bool extract(const std::string& body, std::vector<ModeStats>& out) const {
+        out.assign(modes.size(), ModeStats());
+        Handler handler(modes, out);
+        bool ok = nlohmann::json::sax_parse(body, &handler);
+        return ok || handler.complete();
+    }
+
+    // Single-mode convenience; `found` is false if the mode or its "last"
+    // entry is missing.
+    static bool extract(const std::string& body, const std::string& mode, ModeStats& out) {
+        StatsExtractor extractor(std::vector<std::string>(1, mode));
+        std::vector<ModeStats> stats;
+        bool ok = extractor.extract(body, stats);
+        out = stats[0];
+        return ok;
+    }
+
+    struct BenchmarkReport {
+        size_t responses;
+        double domSeconds;         // json::parse + operator[] lookups
+        double saxSeconds;
+        double domNodeAllocations; // json node allocations per response
+        double domAllocations;     // heap allocations per response, NaN without a counter
+        double saxAllocations;
+        bool agree;                // both paths read the same numbers
+    };
+
+    // Running total of heap allocations, e.g. kept by a replacement global
+    // operator new in the benchmark binary.
+    typedef std::function<size_t()> AllocationCounter;
+
+    // Parse time and allocations of the DOM path (what getPlayerStats used to
+    // do) against extract() over recorded responses. The json values' own
+    // allocator counts the object, array and string nodes the DOM creates.
+    // Given `allocations`, every heap allocation made while parsing is
+    // counted for both paths the same way, which also covers the SAX path's
+    // lexer buffer, handler state and results.
+    BenchmarkReport benchmark(const std::vector<std::string>& responses, int rounds = 100,
+                              const AllocationCounter& allocations = AllocationCounter()) const {
+        BenchmarkReport report = BenchmarkReport();
+        report.responses = responses.size();
+        report.domAllocations = report.saxAllocations = NAN;
+        report.agree = true;
+        if (responses.empty() || rounds <= 0) return report;
+        const double parses = static_cast<double>(rounds) * responses.size();
+
+        std::vector<ModeStats> sax, dom(modes.size());
+        for (const std::string& body : responses) {
+            extract(body, sax);
+            readDom(body, dom);
+            for (size_t m = 0; m < modes.size(); ++m) {
+                report.agree = report.agree && sax[m].found == dom[m].found && sax[m].rating == dom[m].rating &&
+                               sax[m].rd == dom[m].rd;
+            }
+        }
+
+        allocationCount() = 0;
+        size_t before = allocations ? allocations() : 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const std::string& body : responses) readDom(body, dom);
+        }
+        report.domSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (allocations) report.domAllocations = (allocations() - before) / parses;
+        report.domNodeAllocations = allocationCount() / parses;
+
+        before = allocations ? allocations() : 0;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const std::string& body : responses) extract(body, sax);
+        }
+        report.saxSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (allocations) report.saxAllocations = (allocations() - before) / parses;
+        return report;
+    }
+
+private:
+    std::vector<std::string> modes;
+
+    // The DOM path the benchmark compares against.
+    void readDom(const std::string& body, std::vector<ModeStats>& out) const {
+        CountedJson j = CountedJson::parse(body, nullptr, false);
+        for (size_t m = 0; m < modes.size(); ++m) {
+            out[m] = ModeStats();
+            if (j.is_object() && j.contains(modes[m]) && j[modes[m]].contains("last")) {
+                out[m].rating = j[modes[m]]["last"]["rating"];
+                out[m].rd = j[modes[m]]["last"]["rd"];
+                out[m].found = true;
+            }
+        }
+    }
+
+    class Handler {
+    public:
+        Handler(const std::vector<std::string>& modes, std::vector<ModeStats>& out)
+            : modes(modes), out(out), depth(0), remaining(2 * modes.size()) {
+            for (Level& l : path) l = Level();
+            seen.assign(modes.size(), 0);
+        }
+
+        bool complete() const { return remaining == 0; }
+
+        bool null() { return true; }
+        bool boolean(bool) { return true; }
+        bool number_integer(nlohmann::json::number_integer_t v) { return number(static_cast<double>(v)); }
+        bool number_unsigned(nlohmann::json::number_unsigned_t v) { return number(static_cast<double>(v)); }
+        bool number_float(nlohmann::json::number_float_t v, const std::string&) { return number(v); }
+        bool string(std::string&) { return true; }
+        bool binary(nlohmann::json::binary_t&) { return true; }
+
+        bool start_object(std::size_t) { return push(); }
+        bool start_array(std::size_t) { return push(); }
+        bool end_object() { return pop(); }
+        bool end_array() { return pop(); }
+
+        bool key(std::string& k) {
+            if (depth >= kLevels) return true;
+            Level& l = path[depth];
+            l.mode = -1;
+            l.field = None;
+            if (depth == 1) {
+                for (size_t m = 0; m < modes.size(); ++m) {
+                    if (k == modes[m]) l.mode = static_cast<int>(m);
+                }
+            } else if (depth == 2) {
+                l.field = k == "last" ? Last : None;
+            } else if (depth == 3) {
+                l.field = k == "rating" ? Rating : k == "rd" ? RD : None;
+            }
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) { return false; }
+
+    private:
+        enum Field { None, Last, Rating, RD };
+        struct Level {
+            int mode = -1;
+            Field field = None;
+        };
+        static const int kLevels = 4;
+
+        const std::vector<std::string>& modes;
+        std::vector<ModeStats>& out;
+        Level path[kLevels];
+        std::vector<unsigned char> seen; // bit 0 rating, bit 1 rd
+        int depth;
+        size_t remaining;
+
+        bool push() {
+            ++depth;
+            if (depth < kLevels) path[depth] = Level();
+            return true;
+        }
+
+        bool pop() {
+            --depth;
+            return true;
+        }
+
+        // Returning false ends the parse early once everything is found.
+        bool number(double v) {
+            if (depth != 3 || path[1].mode < 0 || path[2].field != Last) return true;
+            const int m = path[1].mode;
+            const Field f = path[3].field;
+            if (f != Rating && f != RD) return true;
+            const unsigned char bit = f == Rating ? 1 : 2;
+            (f == Rating ? out[m].rating : out[m].rd) = static_cast<int>(v);
+            if (!(seen[m] & bit)) {
+                seen[m] |= bit;
+                --remaining;
+            }
+            out[m].found = seen[m] == 3;
+            return remaining > 0;
+        }
+    };
+
+    static std::atomic<size_t>& allocationCount() {
+        static std::atomic<size_t> count(0);
+        return count;
+    }
+
+    template <class T>
+    struct CountingAllocator : std::allocator<T> {
+        template <class U>
+        struct rebind {
+            typedef CountingAllocator<U> other;
+        };
+
+        CountingAllocator() = default;
+        template <class U>
+        CountingAllocator(const CountingAllocator<U>&) {}
+
+        T* allocate(size_t n) {
+            ++allocationCount();
+            return std::allocator<T>::allocate(n);
+        }
+    };
+
+    typedef nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double,
+                                 CountingAllocator>
+        CountedJson;
+};
+
+// Every time control of one /stats response in a fixed layout, so switching
+// modes is an array index instead of another fetch.
+struct PlayerStats {
+    enum Mode { Bullet, Blitz, Rapid, Daily, Daily960, kModes };
+
+    ModeStats modes[kModes];
+
+    static const char* key(int mode) {
+        static const char* const keys[kModes] = {"chess_bullet", "chess_blitz", "chess_rapid", "chess_daily",
+                                                 "chess960_daily"};
+        return keys[mode];
+    }
+
+    static const char* label(int mode) {
+        static const char* const labels[kModes] = {"Bullet", "Blitz", "Rapid", "Daily", "Daily 960"};
+        return labels[mode];
+    }
+
+    // Mode index of an API key such as "chess_bullet", or -1.
+    static int index(const std::string& gamemode) {
+        for (int m = 0; m < kModes; ++m) {
+            if (gamemode == key(m)) return m;
+        }
+        return -1;
+    }
+
+    const ModeStats& operator[](int mode) const { return modes[mode]; }
+
+    // Reads all modes from one response; false if the body is not valid JSON.
+    bool load(const std::string& body) {
+        static const StatsExtractor extractor(std::vector<std::string>(
+            {key(Bullet), key(Blitz), key(Rapid), key(Daily), key(Daily960)}));
+        std::vector<ModeStats> found;
+        bool ok = extractor.extract(body, found);
+        for (int m = 0; m < kModes; ++m) modes[m] = found[m];
+        return ok;
+    }
+};
+
+#endif // STATS_EXTRACTOR_H
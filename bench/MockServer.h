@@ -0,0 +1,452 @@
+#ifndef MOCK_SERVER_H
+#define MOCK_SERVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+// Loopback stand-in for api.chess.com in the benchmarks. Every request is
+// answered by a handler and connections are kept alive. Over TLS the server
+// offers HTTP/2 through ALPN with HTTP/1.1 as the fallback, as the real API
+// does; its self-signed certificate for localhost is written to caFile(),
+// which CurlPool::setCAInfo accepts.
+//
+// The HTTP/2 side is the minimum libcurl needs: SETTINGS, PING and GOAWAY,
+// and one HEADERS + DATA reply per stream. Request headers are not HPACK
+// decoded, so under HTTP/2 the handler sees an empty path, and bodies must
+// fit the initial 64 KiB flow-control window. Serve plain HTTP or HTTP/1.1
+// when the reply depends on the path.
+class MockServer {
+public:
+    struct Reply {
+        long status;
+        std::string body;
+        double retryAfter; // seconds, sent as Retry-After when positive
+        double delay;      // seconds to wait before answering
+    };
+
+    typedef std::function<Reply(const std::string& path)> Handler;
+
+    struct Config {
+        bool tls;
+        bool http2; // offer h2 over TLS
+        Handler handler;
+
+        Config() : tls(true), http2(true) {}
+    };
+
+    struct Stats {
+        size_t connections;
+        size_t resumedSessions; // TLS handshakes that resumed an earlier session
+        size_t http1Requests;
+        size_t http2Requests;
+    };
+
+    explicit MockServer(const Config& config) : config(config), stats_(), ctx(nullptr), stopping(false) {
+        if (!this->config.handler) throw std::invalid_argument("MockServer: no handler");
+        std::signal(SIGPIPE, SIG_IGN); // a client hanging up must not kill the process
+        if (config.tls) createContext();
+
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd < 0) throw std::runtime_error("MockServer: socket failed");
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = sockaddr_in();
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listenFd, 64) != 0 ||
+            getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            close(listenFd);
+            cleanupContext();
+            throw std::runtime_error("MockServer: cannot listen on loopback");
+        }
+        port_ = ntohs(addr.sin_port);
+        acceptor = std::thread([this]() { acceptLoop(); });
+    }
+
+    ~MockServer() {
+        stopping = true;
+        shutdown(listenFd, SHUT_RDWR);
+        acceptor.join();
+        close(listenFd);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int fd : clients) shutdown(fd, SHUT_RDWR);
+        }
+        for (std::thread& t : workers) t.join();
+        cleanupContext();
+    }
+
+    MockServer(const MockServer&) = delete;
+    MockServer& operator=(const MockServer&) = delete;
+
+    int port() const { return port_; }
+
+    std::string url(const std::string& path) const {
+        return (config.tls ? "https://localhost:" : "http://localhost:") + std::to_string(port_) + path;
+    }
+
+    // PEM certificate to trust; empty for a plain HTTP server.
+    const std::string& caFile() const { return certFile; }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats_;
+    }
+
+private:
+    // One accepted connection, with or without TLS.
+    struct Connection {
+        int fd;
+        SSL* ssl;
+
+        bool read(void* data, size_t n) {
+            char* p = static_cast<char*>(data);
+            while (n > 0) {
+                int got = ssl ? SSL_read(ssl, p, static_cast<int>(std::min<size_t>(n, 1 << 20)))
+                              : static_cast<int>(recv(fd, p, n, 0));
+                if (got <= 0) return false;
+                p += got;
+                n -= static_cast<size_t>(got);
+            }
+            return true;
+        }
+
+        // Whatever is available, at most n bytes; 0 when the peer is gone.
+        size_t readSome(void* data, size_t n) {
+            int got = ssl ? SSL_read(ssl, data, static_cast<int>(n)) : static_cast<int>(recv(fd, data, n, 0));
+            return got > 0 ? static_cast<size_t>(got) : 0;
+        }
+
+        bool write(const std::string& data) {
+            const char* p = data.data();
+            size_t n = data.size();
+            while (n > 0) {
+                int sent = ssl ? SSL_write(ssl, p, static_cast<int>(n))
+                               : static_cast<int>(send(fd, p, n, MSG_NOSIGNAL));
+                if (sent <= 0) return false;
+                p += sent;
+                n -= static_cast<size_t>(sent);
+            }
+            return true;
+        }
+    };
+
+    // HTTP/2 frame types and flags (RFC 7540 section 6).
+    enum FrameType { kData = 0, kHeaders = 1, kSettings = 4, kPing = 6, kGoAway = 7, kContinuation = 9 };
+    static const uint8_t kEndStream = 0x1, kAck = 0x1, kEndHeaders = 0x4;
+    static const size_t kMaxFrame = 16384;
+
+    Config config;
+    mutable std::mutex mutex;
+    Stats stats_;
+    SSL_CTX* ctx;
+    std::string certFile;
+    int listenFd;
+    int port_;
+    std::atomic<bool> stopping;
+    std::set<int> clients;
+    std::vector<std::thread> workers;
+    std::thread acceptor;
+
+    void createContext() {
+        EVP_PKEY* key = EVP_EC_gen("P-256");
+        X509* cert = X509_new();
+        bool ok = key && cert;
+        if (ok) {
+            X509_set_version(cert, 2);
+            ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+            X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+            X509_gmtime_adj(X509_getm_notAfter(cert), 7 * 86400);
+            X509_set_pubkey(cert, key);
+            X509_NAME* name = X509_get_subject_name(cert);
+            X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                       reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+            X509_set_issuer_name(cert, name);
+            X509V3_CTX v3;
+            X509V3_set_ctx_nodb(&v3);
+            X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+            const std::pair<int, const char*> extensions[] = {
+                {NID_basic_constraints, "critical,CA:TRUE"},
+                {NID_subject_alt_name, "DNS:localhost,IP:127.0.0.1"},
+            };
+            for (const auto& e : extensions) {
+                X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &v3, e.first, e.second);
+                ok = ok && ext && X509_add_ext(cert, ext, -1);
+                X509_EXTENSION_free(ext);
+            }
+            ok = ok && X509_sign(cert, key, EVP_sha256()) > 0;
+        }
+
+        ctx = ok ? SSL_CTX_new(TLS_server_method()) : nullptr;
+        ok = ctx && SSL_CTX_use_certificate(ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+        if (ok) {
+            SSL_CTX_set_alpn_select_cb(ctx, selectProtocol, this);
+            char path[] = "/tmp/mockserver-XXXXXX";
+            int fd = mkstemp(path);
+            FILE* out = fd >= 0 ? fdopen(fd, "w") : nullptr;
+            ok = out && PEM_write_X509(out, cert) == 1;
+            if (out) fclose(out);
+            if (fd >= 0) certFile = path;
+        }
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        if (!ok) {
+            cleanupContext();
+            throw std::runtime_error("MockServer: cannot create the TLS certificate");
+        }
+    }
+
+    void cleanupContext() {
+        if (ctx) SSL_CTX_free(ctx);
+        ctx = nullptr;
+        if (!certFile.empty()) std::remove(certFile.c_str());
+    }
+
+    static int selectProtocol(SSL*, const unsigned char** out, unsigned char* outlen, const unsigned char* in,
+                              unsigned int inlen, void* arg) {
+        static const unsigned char offered[] = "\x02h2\x08http/1.1";
+        const bool http2 = static_cast<MockServer*>(arg)->config.http2;
+        const unsigned char* prefs = http2 ? offered : offered + 3;
+        const unsigned int prefsLen = http2 ? 12 : 9;
+        unsigned char* selected = nullptr;
+        if (SSL_select_next_proto(&selected, outlen, prefs, prefsLen, in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+            return SSL_TLSEXT_ERR_NOACK;
+        }
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+
+    void acceptLoop() {
+        for (;;) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                if (stopping) return;
+                continue;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                close(fd);
+                return;
+            }
+            clients.insert(fd);
+            ++stats_.connections;
+            workers.emplace_back([this, fd]() { serve(fd); });
+        }
+    }
+
+    void serve(int fd) {
+        Connection c = {fd, nullptr};
+        bool http2 = false;
+        if (ctx) {
+            c.ssl = SSL_new(ctx);
+            SSL_set_fd(c.ssl, fd);
+            if (SSL_accept(c.ssl) == 1) {
+                const unsigned char* proto = nullptr;
+                unsigned int len = 0;
+                SSL_get0_alpn_selected(c.ssl, &proto, &len);
+                http2 = len == 2 && std::memcmp(proto, "h2", 2) == 0;
+                if (SSL_session_reused(c.ssl)) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++stats_.resumedSessions;
+                }
+                if (http2) {
+                    serveHTTP2(c);
+                } else {
+                    serveHTTP1(c);
+                }
+                SSL_shutdown(c.ssl);
+            }
+            SSL_free(c.ssl);
+        } else {
+            serveHTTP1(c);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        clients.erase(fd);
+        close(fd);
+    }
+
+    Reply answer(const std::string& path, size_t Stats::*counter) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++(stats_.*counter);
+        }
+        Reply reply = config.handler(path);
+        auto until = std::chrono::steady_clock::now() + std::chrono::duration<double>(reply.delay);
+        while (!stopping && std::chrono::steady_clock::now() < until) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return reply;
+    }
+
+    void serveHTTP1(Connection& c) {
+        std::string buffer;
+        char chunk[4096];
+        while (!stopping) {
+            size_t end;
+            while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                size_t got = c.readSome(chunk, sizeof(chunk));
+                if (got == 0) return;
+                buffer.append(chunk, got);
+            }
+            // "GET /path HTTP/1.1"; request bodies are not expected.
+            const size_t a = buffer.find(' '), b = buffer.find(' ', a + 1);
+            const std::string path = a < end && b < end ? buffer.substr(a + 1, b - a - 1) : "/";
+            buffer.erase(0, end + 4);
+
+            Reply reply = answer(path, &Stats::http1Requests);
+            std::string out = "HTTP/1.1 " + std::to_string(reply.status) + " " + reason(reply.status) + "\r\n";
+            out += "Content-Type: application/json\r\n";
+            out += "Content-Length: " + std::to_string(reply.body.size()) + "\r\n";
+            if (reply.retryAfter > 0) out += "Retry-After: " + seconds(reply.retryAfter) + "\r\n";
+            out += "\r\n" + reply.body;
+            if (!c.write(out)) return;
+        }
+    }
+
+    void serveHTTP2(Connection& c) {
+        char preface[24];
+        if (!c.read(preface, sizeof(preface)) ||
+            std::memcmp(preface, "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n", sizeof(preface)) != 0) {
+            return;
+        }
+        if (!c.write(frame(kSettings, 0, 0, std::string()))) return;
+
+        bool continuedEnds = false;      // the open header block ends its stream
+        std::set<uint32_t> awaitingData; // headers done, body still coming
+        while (!stopping) {
+            unsigned char h[9];
+            if (!c.read(h, sizeof(h))) return;
+            const size_t len = static_cast<size_t>(h[0]) << 16 | h[1] << 8 | h[2];
+            const uint8_t type = h[3], flags = h[4];
+            const uint32_t stream = static_cast<uint32_t>(h[5] & 0x7f) << 24 | h[6] << 16 | h[7] << 8 | h[8];
+            std::string payload(len, '\0');
+            if (len > 0 && !c.read(&payload[0], len)) return;
+
+            uint32_t complete = 0; // stream whose request is now complete
+            switch (type) {
+                case kSettings:
+                    if (!(flags & kAck) && !c.write(frame(kSettings, kAck, 0, std::string()))) return;
+                    break;
+                case kPing:
+                    if (!(flags & kAck) && !c.write(frame(kPing, kAck, 0, payload))) return;
+                    break;
+                case kGoAway:
+                    return;
+                case kHeaders:
+                case kContinuation: {
+                    const bool ends = type == kHeaders ? (flags & kEndStream) != 0 : continuedEnds;
+                    if (!(flags & kEndHeaders)) {
+                        continuedEnds = ends;
+                    } else if (ends) {
+                        complete = stream;
+                    } else {
+                        awaitingData.insert(stream);
+                    }
+                    break;
+                }
+                case kData:
+                    if ((flags & kEndStream) && awaitingData.erase(stream)) complete = stream;
+                    break;
+                default: // PRIORITY, RST_STREAM, WINDOW_UPDATE, ...
+                    break;
+            }
+            if (complete != 0 && !respondHTTP2(c, complete)) return;
+        }
+    }
+
+    bool respondHTTP2(Connection& c, uint32_t stream) {
+        Reply reply = answer(std::string(), &Stats::http2Requests);
+        // Literal header fields without indexing, names from the HPACK static
+        // table: 8 :status, 28 content-length, 31 content-type, 53 retry-after.
+        std::string block;
+        literal(block, 8, std::to_string(reply.status));
+        literal(block, 31, "application/json");
+        literal(block, 28, std::to_string(reply.body.size()));
+        if (reply.retryAfter > 0) literal(block, 53, seconds(reply.retryAfter));
+
+        std::string out = frame(kHeaders, kEndHeaders | (reply.body.empty() ? kEndStream : 0), stream, block);
+        for (size_t at = 0; at < reply.body.size(); at += kMaxFrame) {
+            const bool last = at + kMaxFrame >= reply.body.size();
+            out += frame(kData, last ? kEndStream : 0, stream, reply.body.substr(at, kMaxFrame));
+        }
+        return c.write(out);
+    }
+
+    static std::string frame(uint8_t type, uint8_t flags, uint32_t stream, const std::string& payload) {
+        std::string f(9, '\0');
+        f[0] = static_cast<char>(payload.size() >> 16);
+        f[1] = static_cast<char>(payload.size() >> 8);
+        f[2] = static_cast<char>(payload.size());
+        f[3] = static_cast<char>(type);
+        f[4] = static_cast<char>(flags);
+        f[5] = static_cast<char>(stream >> 24 & 0x7f);
+        f[6] = static_cast<char>(stream >> 16);
+        f[7] = static_cast<char>(stream >> 8);
+        f[8] = static_cast<char>(stream);
+        return f + payload;
+    }
+
+    // HPACK integer with an n-bit prefix (RFC 7541 section 5.1).
+    static void integer(std::string& out, uint8_t high, int n, size_t value) {
+        const size_t max = (size_t(1) << n) - 1;
+        if (value < max) {
+            out += static_cast<char>(high | value);
+            return;
+        }
+        out += static_cast<char>(high | max);
+        for (value -= max; value >= 128; value /= 128) out += static_cast<char>(value % 128 + 128);
+        out += static_cast<char>(value);
+    }
+
+    static void literal(std::string& out, size_t nameIndex, const std::string& value) {
+        integer(out, 0x00, 4, nameIndex);
+        integer(out, 0x00, 7, value.size()); // not Huffman coded
+        out += value;
+    }
+
+    static std::string seconds(double s) {
+        return std::to_string(static_cast<long>(std::ceil(s)));
+    }
+
+    static const char* reason(long status) {
+        switch (status) {
+            case 200: return "OK";
+            case 404: return "Not Found";
+            case 429: return "Too Many Requests";
+            case 500: return "Internal Server Error";
+            case 503: return "Service Unavailable";
+            default: return "Status";
+        }
+    }
+};
+
+#endif // MOCK_SERVER_H
@@ -0,0 +1,54 @@
+// Latency of stats requests through CurlPool: a cold handle and a full TLS
+// handshake per request against the pool's warm connections.
+//
+//   curl_bench [requests] [url]
+//
+// Without a URL the requests go to a loopback MockServer, once negotiating
+// HTTP/2 and once HTTP/1.1, so only the connection and handshake cost is
+// measured.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "CurlPool.h"
+#include "MockServer.h"
+
+static void print(const std::string& label, const CurlPool::LatencyReport& r) {
+    std::cout << label << ", " << r.requests << " requests\n"
+              << std::fixed << std::setprecision(3) << "  cold    mean " << r.coldMean * 1e3 << " ms  median "
+              << r.coldMedian * 1e3 << " ms\n"
+              << "  pooled  mean " << r.pooledMean * 1e3 << " ms  median " << r.pooledMedian * 1e3 << " ms\n"
+              << std::setprecision(1) << "  pooled is " << (r.pooledMedian > 0 ? r.coldMedian / r.pooledMedian : 0)
+              << "x faster (median)\n";
+}
+
+int main(int argc, char** argv) {
+    const int requests = argc > 1 ? std::atoi(argv[1]) : 200;
+    if (argc > 2) {
+        print(argv[2], CurlPool::benchmark(argv[2], requests));
+        return 0;
+    }
+
+    // Shaped like a trimmed /pub/player/{username}/stats response.
+    const std::string body =
+        "{\"chess_bullet\":{\"last\":{\"rating\":2412,\"date\":1700000000,\"rd\":61},"
+        "\"best\":{\"rating\":2530,\"date\":1690000000,\"game\":\"https://www.chess.com/game/live/1\"},"
+        "\"record\":{\"win\":5120,\"loss\":4310,\"draw\":402}},"
+        "\"chess_blitz\":{\"last\":{\"rating\":2201,\"date\":1700000000,\"rd\":75},"
+        "\"record\":{\"win\":1200,\"loss\":1100,\"draw\":150}},\"fide\":0}";
+    for (bool http2 : {true, false}) {
+        MockServer::Config config;
+        config.http2 = http2;
+        config.handler = [&body](const std::string&) { return MockServer::Reply{200, body, 0, 0}; };
+        MockServer server(config);
+        CurlPool::instance().setCAInfo(server.caFile());
+        CurlPool::LatencyReport report = CurlPool::benchmark(server.url("/pub/player/hikaru/stats"), requests);
+
+        MockServer::Stats s = server.stats();
+        print(http2 ? "Loopback HTTPS mock, HTTP/2" : "Loopback HTTPS mock, HTTP/1.1", report);
+        std::cout << "  server: " << s.connections << " TLS connections (" << s.resumedSessions << " resumed), "
+                  << s.http2Requests << " HTTP/2 and " << s.http1Requests << " HTTP/1.1 requests\n";
+    }
+    return 0;
+}
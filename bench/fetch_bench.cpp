@@ -0,0 +1,84 @@
+// Wall time of a batch of stats lookups through RequestScheduler: the old
+// transport (four workers, each blocking in CurlPool::get) against the
+// default one (MultiFetch's curl_multi loop).
+//
+//   fetch_bench [usernames] [delay_ms]
+//
+// Requests go to a loopback MockServer that waits `delay_ms` before each
+// reply, standing in for the API's round trip. The token bucket is opened
+// wide so that only the transport limits concurrency. A second run sends the
+// batch over HTTP/2 to show it multiplexed on one connection; the mock
+// answers the streams of a connection in order, so it runs without a delay.
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CurlPool.h"
+#include "MockServer.h"
+#include "MultiFetch.h"
+#include "RequestScheduler.h"
+
+static double batch(RequestScheduler& scheduler, const MockServer& server, int usernames) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::shared_future<CurlPool::Response>> fetched;
+    for (int i = 0; i < usernames; ++i) {
+        fetched.push_back(scheduler.submit(server.url("/pub/player/user" + std::to_string(i) + "/stats")));
+    }
+    for (auto& f : fetched) {
+        if (f.get().status != 200) throw std::runtime_error("fetch_bench: unexpected status");
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    const int usernames = argc > 1 ? std::atoi(argv[1]) : 32;
+    const double delay = (argc > 2 ? std::atof(argv[2]) : 100) / 1e3;
+
+    const std::string body = "{\"chess_bullet\":{\"last\":{\"rating\":2412,\"date\":1700000000,\"rd\":61}}}";
+    RequestScheduler::Config open;
+    open.ratePerSecond = 1e6;
+    open.burst = usernames;
+
+    MockServer::Config config;
+    config.http2 = false;
+    config.handler = [&](const std::string&) { return MockServer::Reply{200, body, 0, delay}; };
+    {
+        MockServer server(config);
+        CurlPool::instance().setCAInfo(server.caFile());
+
+        RequestScheduler::Config old = open;
+        old.workers = 4;
+        CurlPool& pool = CurlPool::instance();
+        double blocking, multi;
+        {
+            RequestScheduler scheduler(old, [&pool](const std::string& url, const RequestScheduler::Abort& abort) {
+                return pool.get(url, abort);
+            });
+            blocking = batch(scheduler, server, usernames);
+        }
+        {
+            RequestScheduler scheduler(open);
+            multi = batch(scheduler, server, usernames);
+        }
+        std::cout << usernames << " lookups, " << delay * 1e3 << " ms server delay, HTTP/1.1\n"
+                  << std::fixed << std::setprecision(3) << "  4 workers on CurlPool::get  " << blocking
+                  << " s\n  " << open.workers << " workers on MultiFetch    " << multi << " s ("
+                  << std::setprecision(1) << blocking / multi << "x)\n";
+    }
+
+    config.http2 = true;
+    config.handler = [&](const std::string&) { return MockServer::Reply{200, body, 0, 0}; };
+    MockServer server(config);
+    CurlPool::instance().setCAInfo(server.caFile());
+    RequestScheduler scheduler(open);
+    const double seconds = batch(scheduler, server, usernames);
+    MockServer::Stats s = server.stats();
+    std::cout << usernames << " lookups, HTTP/2: " << std::setprecision(3) << seconds << " s over " << s.connections
+              << " TLS connection(s), " << s.http2Requests << " HTTP/2 requests\n";
+    return 0;
+}
@@ -0,0 +1,54 @@
+// Throughput and accuracy of the batch and table-driven Glicko-1 kernels.
+//
+//   glicko_bench [pairings] [rounds]
+//
+// Exits with status 1 if a SIMD path exceeds GlickoBatch::kMaxDifference.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "GlickoBatch.h"
+#include "GlickoTables.h"
+
+int main(int argc, char** argv) {
+    const size_t pairings = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 20;
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 10;
+    int status = 0;
+
+    std::cout << "GlickoBatch::calculateNewRatings, " << pairings << " pairings x " << rounds << " rounds\n";
+    for (const GlickoBatch::ThroughputReport& r : GlickoBatch::benchmark(pairings, rounds)) {
+        std::cout << "  " << std::setw(7) << std::left << GlickoBatch::pathName(r.path) << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(8) << r.pairingsPerSecond / 1e6
+                  << "M pairings/s  max diff " << std::scientific << std::setprecision(2) << r.maxDifference
+                  << "\n";
+    }
+
+    std::cout << "GlickoBatch accuracy against scalar (bound " << std::scientific << std::setprecision(1)
+              << GlickoBatch::kMaxDifference << ")\n";
+    for (const GlickoBatch::AccuracyReport& r : GlickoBatch::accuracyReport()) {
+        const bool ok = r.maxRatingDifference <= GlickoBatch::kMaxDifference &&
+                        r.maxOutcomeDifference <= GlickoBatch::kMaxDifference;
+        if (!ok) status = 1;
+        std::cout << "  " << std::setw(7) << std::left << GlickoBatch::pathName(r.path) << std::right
+                  << r.samples << " samples  rating " << std::scientific << std::setprecision(2)
+                  << r.maxRatingDifference
+                  << "  outcomes " << r.maxOutcomeDifference << "  RD " << r.maxRDDifference
+                  << (ok ? "  ok" : "  EXCEEDS BOUND") << std::defaultfloat << std::setprecision(6)
+                  << "  worst at r=" << r.worstR << " RD=" << r.worstRD << " r_j=" << r.worstRj
+                  << " RD_j=" << r.worstRDj << "\n";
+    }
+
+    GlickoTables::AccuracyReport acc = GlickoTables::accuracyReport();
+    std::cout << "GlickoTables accuracy against glickoNewRating, " << acc.samples << " samples\n"
+              << "  max " << std::scientific << std::setprecision(2) << acc.maxAbsError << "  mean "
+              << acc.meanAbsError << std::defaultfloat << "  worst at r=" << acc.worstR << " RD=" << acc.worstRD
+              << " r_j=" << acc.worstRj << " RD_j=" << acc.worstRDj << "\n";
+
+    GlickoTables::SpeedReport speed = GlickoTables::benchmark();
+    std::cout << "GlickoTables::calculate_new_rating on " << speed.pairings << " integer pairings\n"
+              << std::fixed << std::setprecision(1) << "  exact " << speed.pairings / speed.exactSeconds / 1e6
+              << "M/s  table " << speed.pairings / speed.tableSeconds / 1e6 << "M/s  speedup "
+              << std::setprecision(2) << speed.speedup << "x  max diff " << std::scientific << speed.maxAbsError
+              << "\n";
+    return status;
+}
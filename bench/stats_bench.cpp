@@ -0,0 +1,65 @@
+// Parse time and heap allocations of /stats responses: json::parse plus
+// operator[] (the old getPlayerStats) against StatsExtractor's SAX handler.
+//
+//   stats_bench [rounds] [response.json ...]
+//
+// Without files it reads the sample responses in bench/data/stats, shaped
+// like the API's: every mode, a new account with one mode, and modes without
+// a "last" entry. Allocations are counted by the operator new below.
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "StatsExtractor.h"
+
+static std::atomic<size_t> allocations(0);
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("stats_bench: cannot read " + path);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    const int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::vector<std::string> responses;
+    for (int i = 2; i < argc; ++i) responses.push_back(readFile(argv[i]));
+    if (responses.empty()) {
+        for (const char* name : {"all_modes.json", "bullet_only.json", "no_last.json"}) {
+            responses.push_back(readFile(std::string(BENCH_DATA_DIR "/stats/") + name));
+        }
+    }
+
+    const StatsExtractor extractor(std::vector<std::string>({PlayerStats::key(PlayerStats::Bullet),
+        PlayerStats::key(PlayerStats::Blitz), PlayerStats::key(PlayerStats::Rapid),
+        PlayerStats::key(PlayerStats::Daily), PlayerStats::key(PlayerStats::Daily960)}));
+    StatsExtractor::BenchmarkReport r =
+        extractor.benchmark(responses, rounds, []() { return allocations.load(); });
+
+    const double parses = static_cast<double>(rounds) * r.responses;
+    std::cout << r.responses << " responses x " << rounds << " rounds, all five modes"
+              << (r.agree ? "" : " (DOM and SAX DISAGREE)") << "\n"
+              << std::fixed << std::setprecision(2) << "             us/parse  allocations/parse\n"
+              << "  DOM     " << std::setw(11) << r.domSeconds / parses * 1e6 << std::setw(19) << r.domAllocations
+              << "  (" << r.domNodeAllocations << " json nodes)\n"
+              << "  SAX     " << std::setw(11) << r.saxSeconds / parses * 1e6 << std::setw(19) << r.saxAllocations
+              << "\n" << std::setprecision(1) << "  SAX is " << r.domSeconds / r.saxSeconds << "x faster\n";
+    return r.agree ? 0 : 1;
+}
@@ -7,77 +7,110 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QMessageBox>
+#include <QComboBox>
 #include <QString>
+#include <QMetaObject>
 #include <iostream>
+#include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <vector>
-#include <tuple>
 #include <string>
-#include <curl/curl.h>
+#include <memory>
+#include <chrono>
+#include <future>
 #include "nlohmann/json.hpp"
+#include "StatsExtractor.h"
+#include "StatsCache.h"
+#include "CurlPool.h"
+#include "RequestScheduler.h"
+#include "BackgroundWorker.h"
+#include "Glicko.h"
+#include "GlickoTables.h"
+#include "RDSolver.h"
+#include "RDGridSearch.h"
+#include "RiskModel.h"
+#include "DecisionSurface.h"
 
 using json = nlohmann::json;
 using namespace std;
 
-// Constants for the Glicko-1 system
-const double q = 0.0057565;
-const double pi = 3.14159265358979323846;
-
 class Player {
 public:
     int Rating, RD;
     std::string username;
     std::string gamemode;
+    PlayerStats allStats; // every time control from the last fetch
 
-    Player(std::string mode) : gamemode(mode) {}
+    Player(std::string mode) : Rating(0), RD(0), gamemode(mode) {}
 
     void stats(std::string gamemode) {
         fetchPlayerData(username, gamemode);
     }
 
+    // Usernames are case-insensitive on Chess.com. The URL is lowercased so
+    // "Foo" and "foo" share one scheduler request, as they share a cache entry.
+    static std::string statsUrl(const std::string& username) {
+        std::string name(username);
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return "https://api.chess.com/pub/player/" + name + "/stats";
+    }
+
+    // Reads Rating and RD from a stats response fetched elsewhere (e.g.
+    // through the RequestScheduler together with other players).
+    void loadStats(const std::string& body, std::string gamemode) {
+        try {
+            readStats(body, gamemode);
+        } catch (const std::exception& ex) {
+            std::cerr << "Error: " << ex.what() << std::endl;
+        }
+    }
+
+    // Switches Rating and RD to another time control of the last fetch
+    // without going back to the network. Both are 0 if the player has no
+    // rating in that mode.
+    void selectMode(const std::string& mode) {
+        gamemode = mode;
+        int m = PlayerStats::index(mode);
+        const ModeStats none;
+        const ModeStats& stats = m >= 0 ? allStats[m] : none;
+        Rating = stats.found ? stats.rating : 0;
+        RD = stats.found ? stats.rd : 0;
+    }
+
 private:
-    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
-        size_t totalSize = size * nmemb;
-        userp->append((char*)contents, totalSize);
-        return totalSize;
+    std::string getPlayerStats(const std::string& username) {
+        std::string url = statsUrl(username);
+        // Through the scheduler: rate limited, retried on 429/5xx and shared
+        // with any other request for this player already under way.
+        CurlPool::Response response = RequestScheduler::instance().get(url);
+        return response.body;
     }
 
-    json getPlayerStats(const std::string& username) {
-        std::string readBuffer;
-        CURL* curl;
-        CURLcode res;
-        std::string url = "https://api.chess.com/pub/player/" + username + "/stats";
-
-        curl = curl_easy_init();
-        if (curl) {
-            struct curl_slist* headers = NULL;
-            headers = curl_slist_append(headers, "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/58.0.3029.110 Safari/537.3");
-
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-            res = curl_easy_perform(curl);
-            curl_easy_cleanup(curl);
-            curl_slist_free_all(headers);
-
-            if (res != CURLE_OK) {
-                throw std::runtime_error("Failed to fetch data from Chess.com API");
+    // Streams the response into allStats and selects `gamemode`. A mode
+    // outside the fixed set is read on its own.
+    void readStats(const std::string& body, const std::string& gamemode) {
+        if (PlayerStats::index(gamemode) >= 0) {
+            if (!allStats.load(body)) {
+                throw std::runtime_error("Failed to parse stats response");
             }
+            selectMode(gamemode);
+            return;
+        }
+        ModeStats stats;
+        if (!StatsExtractor::extract(body, gamemode, stats)) {
+            throw std::runtime_error("Failed to parse stats response");
+        }
+        if (stats.found) {
+            Rating = stats.rating;
+            RD = stats.rd;
         }
-
-        return json::parse(readBuffer);
     }
 
     void fetchPlayerData(std::string user, std::string gamemode) {
         try {
-            json stats = getPlayerStats(user);
-            if (stats.contains(gamemode) && stats[gamemode].contains("last")) {
-                int rating = stats[gamemode]["last"]["rating"];
-                int rd = stats[gamemode]["last"]["rd"];
-                Rating = rating;
-                RD = rd;
-            }
+            readStats(getPlayerStats(user), gamemode);
         } catch (const std::exception& ex) {
             std::cerr << "Error: " << ex.what() << std::endl;
         }
@@ -86,7 +119,8 @@ private:
 
 class Game {
     double r, RD, r_j, RD_j;
-    std::vector<double> abortsProb;
+    AbortBelief abortsProb; // Uniform prior over [5, 10] aborts left
+    GlickoKernel kernel;
 
 public:
     Game(double playerRating, double playerRD, double oppRating, double oppRD) {
@@ -94,111 +128,80 @@ public:
         RD = playerRD;
         r_j = oppRating;
         RD_j = oppRD;
-        abortsProb = std::vector<double>(6, 1.0 / 6.0); // Uniform prior over [5, 10]
+        kernel = GlickoKernel::Exact;
     }
 
-    double calculate_new_rating(double r, double RD, double r_j, double RD_j, double s) {
-        double gRD_j = 1 / sqrt(1 + 3 * pow(q, 2) * pow(RD_j, 2) / pow(pi, 2));
-        double E = 1 / (1 + pow(10, -gRD_j * (r - r_j) / 400));
-        double sum = pow(gRD_j, 2) * E * (1 - E);
-        double sum_s_minus_E = gRD_j * (s - E);
-
-        double d_2 = 1 / (q * q * sum);
-        double denom = 1 / pow(RD, 2) + 1 / d_2;
-
-        double new_r = r + (q / denom) * sum_s_minus_E;
-        return new_r;
+    // Table uses the compile-time lookup tables for integer inputs and falls
+    // back to the exact formula outside them.
+    void setKernel(GlickoKernel k) {
+        kernel = k;
     }
 
-    std::tuple<double, double, double> calculateRatingRes() {
-        if (RD < 55) { RD = 55; }
-        if (RD_j < 55) { RD_j = 55; }
-        double win = calculate_new_rating(r, RD, r_j, RD_j, 1);
-        double lose = calculate_new_rating(r, RD, r_j, RD_j, 0);
-        double draw = calculate_new_rating(r, RD, r_j, RD_j, 0.5);
-        return std::make_tuple(win, lose, draw);
+    // Scalar reference; GlickoBatch::calculateNewRatings scores many at once.
+    double calculate_new_rating(double r, double RD, double r_j, double RD_j, double s) {
+        if (kernel == GlickoKernel::Table && GlickoTables::covers(r, RD, r_j, RD_j)) {
+            return GlickoTables::calculate_new_rating(r, RD, r_j, RD_j, s);
+        }
+        return glickoNewRating(r, RD, r_j, RD_j, s);
     }
 
-    std::string analyzeRisk(double playerRating, double oppRating, double win, double lose, double draw) {
-        // Calculate the rating difference
-        double ratingDifference = oppRating - playerRating;
-        
-        // Adjust the scaling factor based on the rating difference
-        double scalingFactor = 250.0 / std::abs(ratingDifference);
-        
-        // Bradley-Terry model for probability estimation
-        double win_prob = 1 / (1 + pow(10, ratingDifference / 400));
-        double lose_prob = 1 / (1 + pow(10, -ratingDifference / 400));
-        double draw_prob = 1 - win_prob - lose_prob;
-
-
-        // Normalize probabilities to sum to 1
-        double sum_probs = win_prob + lose_prob + draw_prob;
-        win_prob /= sum_probs;
-        lose_prob /= sum_probs;
-        draw_prob /= sum_probs;
-
-        win_prob *= scalingFactor;
-        lose_prob /= scalingFactor;
-
-        // Calculate the expected value (EV)
-        double expected_value = (win - playerRating) * win_prob +
-                                (lose - playerRating) * lose_prob +
-                                (draw - playerRating) * draw_prob;
-
-        // Risk-reward analysis
-        double risk_reward_ratio = (win - playerRating) / (playerRating - lose);
-
-        // Volatility adjustment
-        double volatility = sqrt(pow(RD, 2) + pow(RD_j, 2));
-        double adjusted_expected_value = expected_value / volatility;
-        
-        // Scarcity factor adjustment
-        double scarcity_factor = 1.0;
-        if (expected_value < 0) {
-            scarcity_factor = 1.0 / (std::count_if(abortsProb.begin(), abortsProb.end(), [](double p) { return p > 0; }));
+    RatingOutcomes calculateRatingRes() {
+        if (RD < kChessComRDFloor) { RD = kChessComRDFloor; }
+        if (RD_j < kChessComRDFloor) { RD_j = kChessComRDFloor; }
+        if (kernel == GlickoKernel::Table && GlickoTables::covers(r, RD, r_j, RD_j)) {
+            return GlickoTables::outcomes(r, RD, r_j, RD_j);
         }
+        return glickoOutcomes(r, RD, r_j, RD_j);
+    }
 
-        // Adjust decision thresholds dynamically based on scarcity factor
-        double min_acceptable_gain = 5.0 * scarcity_factor;
-        double max_acceptable_loss = -10.0 / scarcity_factor;
-
-        // Determine the number of aborts left (based on the current belief)
-        double expected_aborts_left = 0.0;
-        for (int i = 0; i < abortsProb.size(); ++i) {
-            expected_aborts_left += abortsProb[i] * (5 + i);
+    // Recovers the player's RD behind an observed post-game rating, holding
+    // the opponent's RD fixed. With exhaustive set, both RDs are searched on
+    // the README's 1-500 x 1-350 grid and refined down to a 0.01 step. See
+    // RDSolver and RDGridSearch for batches over many games.
+    void reverseEngineerRD(double observed_new_r, double s, bool exhaustive = false) {
+        RatingObservation obs(r, r_j, s, observed_new_r);
+        double best_RD, best_RD_j, best_error;
+        if (exhaustive) {
+            RDGridSearch::Config config;
+            config.refineLevels = 2;
+            RDGridSearch::Result res = RDGridSearch::search(std::vector<RatingObservation>(1, obs), config);
+            best_RD = res.RD;
+            best_RD_j = res.RD_j;
+            best_error = res.maxError;
+        } else {
+            RDEstimate est = RDSolver::solveRD(obs, RD_j);
+            best_RD = est.RD;
+            best_RD_j = est.RD_j;
+            best_error = std::abs(est.residual);
         }
 
-        std::string decision;
+        std::cout << "Best estimated player RD: " << best_RD << std::endl;
+        std::cout << "Best estimated opponent RD: " << best_RD_j << std::endl;
+        std::cout << "Error: " << best_error << std::endl;
+    }
 
-        if (adjusted_expected_value > 0 && risk_reward_ratio > 1.0 && win - playerRating > min_acceptable_gain) {
-            decision = "Play on: Positive expected value with favorable risk-reward ratio.";
-        } else if (lose - playerRating < max_acceptable_loss) {
-            decision = "Abort: High risk with significant potential loss.";
-        } else if (expected_aborts_left > 0) {
-            decision = "Abort: Negative or insufficient expected value.";
-        } else {
-            decision = "Play on: Limited aborts left.";
-        }
+    // Evaluates the pairing and, on an abort, spends one abort from the
+    // belief. RiskScreen does the same for many opponents at once.
+    RiskAssessment assessRisk(double playerRating, double oppRating, double win, double lose, double draw) {
+        RiskAssessment risk = evaluateRisk(playerRating, oppRating, win, lose, draw, RD, RD_j, abortsProb);
 
         // Update the belief about the number of aborts left if decision is to abort
-        if (decision.find("Abort") != std::string::npos) {
-            std::vector<double> updatedAbortsProb(6, 0.0);
-            for (int i = 0; i < abortsProb.size(); ++i) {
-                if (i < abortsProb.size() - 1) {
-                    updatedAbortsProb[i] = abortsProb[i + 1];
-                }
-            }
-            abortsProb = updatedAbortsProb;
+        if (isAbort(risk.decision)) {
+            abortsProb.recordAbort();
         }
+        return risk;
+    }
 
-        return decision;
+    std::string analyzeRisk(double playerRating, double oppRating, double win, double lose, double draw) {
+        return decisionText(assessRisk(playerRating, oppRating, win, lose, draw).decision);
     }
+
+    int abortsUsed() const { return abortsProb.abortsRecorded(); }
 };
 
 class ChessRatingApp : public QWidget {
 public:
-    ChessRatingApp(QWidget* parent = 0) : QWidget(parent) {
+    ChessRatingApp(QWidget* parent = 0) : QWidget(parent), cache(openCache()) {
         QVBoxLayout* mainLayout = new QVBoxLayout(this);
 
         QLabel* playerLabel = new QLabel("Enter Player Chess.com Username:", this);
@@ -207,6 +210,14 @@ public:
         QLabel* opponentLabel = new QLabel("Enter Opponent Chess.com Username:", this);
         opponentEdit = new QLineEdit(this);
 
+        QLabel* modeLabel = new QLabel("Time Control:", this);
+        modeBox = new QComboBox(this);
+        for (int m = 0; m < PlayerStats::kModes; ++m) {
+            modeBox->addItem(PlayerStats::label(m));
+        }
+        connect(modeBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
+                &ChessRatingApp::onModeChanged);
+
         calculateButton = new QPushButton("Calculate", this);
         connect(calculateButton, &QPushButton::clicked, this, &ChessRatingApp::onCalculate);
 
@@ -218,6 +229,8 @@ public:
         mainLayout->addWidget(playerEdit);
         mainLayout->addWidget(opponentLabel);
         mainLayout->addWidget(opponentEdit);
+        mainLayout->addWidget(modeLabel);
+        mainLayout->addWidget(modeBox);
         mainLayout->addWidget(calculateButton);
         mainLayout->addWidget(newGameButton);
         mainLayout->addWidget(outputLabel);
@@ -229,50 +242,161 @@ public:
 
 private slots:
     void onCalculate() {
-        QString playerUsername = playerEdit->text();
-        QString opponentUsername = opponentEdit->text();
+        startLookup(true);
+    }
+    // Every mode came with the last fetch, so switching only recomputes.
+    void onModeChanged(int) {
+        if (playerEdit->text().isEmpty() || opponentEdit->text().isEmpty()) return;
+        startLookup(false);
+    }
+    void onNewGame() {
+        worker.cancel();
+        opponentEdit->clear();
+        outputLabel->clear();
+    }
 
-        Player player("chess_bullet");
-        player.username = playerUsername.toStdString();
-        player.stats("chess_bullet");
+private:
+    QLineEdit* playerEdit;
+    QLineEdit* opponentEdit;
+    QComboBox* modeBox;
+    QPushButton* calculateButton;
+    QPushButton* newGameButton;
+    QLabel* outputLabel;
+    DecisionSurfaceCache surface;
+    std::unique_ptr<StatsCache> cache; // every player fetched so far, kept across runs
+    BackgroundWorker worker; // last: joined before the members its jobs use
+
+    void startLookup(bool refetch) {
+        std::string playerUsername = playerEdit->text().toStdString();
+        std::string opponentUsername = opponentEdit->text().toStdString();
+        std::string gamemode = PlayerStats::key(modeBox->currentIndex());
+
+        // Fetching and the rating maths run on the worker thread so the
+        // window stays responsive. A newer lookup cancels this one.
+        outputLabel->setText("Looking up players...");
+        worker.submit([this, playerUsername, opponentUsername, gamemode, refetch](
+                          unsigned generation, const BackgroundWorker::Cancelled& cancelled) {
+            lookup(generation, cancelled, playerUsername, opponentUsername, gamemode, refetch);
+        });
+    }
 
-        Player opponent("chess_bullet");
-        opponent.username = opponentUsername.toStdString();
-        opponent.stats("chess_bullet");
+    // Fetch, Glicko and risk for one lookup. Runs on the worker thread; only
+    // post() touches the widgets.
+    //
+    // Players in the stats cache are shown straight away. Without `refetch`
+    // (a time control switch) any cached entry is used as is; otherwise
+    // entries past the TTL are shown marked as cached and then refreshed.
+    void lookup(unsigned generation, const BackgroundWorker::Cancelled& cancelled, const std::string& playerUsername,
+                const std::string& opponentUsername, const std::string& gamemode, bool refetch) {
+        Player player(gamemode);
+        player.username = playerUsername;
+
+        Player opponent(gamemode);
+        opponent.username = opponentUsername;
+
+        std::vector<Player*> missing;
+        bool cached = false;
+        for (Player* p : {&player, &opponent}) {
+            StatsCache::Entry entry;
+            if (cache->lookup(p->username, entry)) {
+                p->allStats = entry.stats;
+                p->selectMode(gamemode);
+                cached = true;
+                if (!refetch || !entry.stale) continue;
+            }
+            missing.push_back(p);
+        }
+        if (!missing.empty() && cached && player.Rating != 0 && opponent.Rating != 0) {
+            showResult(generation, player, opponent, "\n\n(Cached ratings, refreshing...)");
+        }
+
+        // The lookups go out together, so the wait is the slower of the
+        // round trips rather than their sum. They jump ahead of background
+        // requests, and a player another request is already fetching is not
+        // fetched twice.
+        // A superseded lookup withdraws the requests it is still waiting
+        // for, which aborts them unless another request shares them.
+        RequestScheduler& scheduler = RequestScheduler::instance();
+        std::vector<std::shared_future<CurlPool::Response>> fetched;
+        for (Player* p : missing) {
+            fetched.push_back(scheduler.submit(Player::statsUrl(p->username)));
+        }
+        for (size_t i = 0; i < fetched.size(); ++i) {
+            while (fetched[i].wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+                if (cancelled()) {
+                    for (size_t k = i; k < fetched.size(); ++k) {
+                        if (fetched[k].wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                            scheduler.cancel(Player::statsUrl(missing[k]->username));
+                        }
+                    }
+                    return;
+                }
+            }
+            try {
+                const CurlPool::Response& response = fetched[i].get();
+                if (response.status == 200) {
+                    missing[i]->loadStats(response.body, gamemode);
+                    cache->store(missing[i]->username, missing[i]->allStats);
+                } else {
+                    std::cerr << "Error: Chess.com API returned HTTP " << response.status << std::endl;
+                }
+            } catch (const std::exception& ex) {
+                std::cerr << "Error: " << ex.what() << std::endl;
+            }
+        }
+        if (cancelled()) return;
 
         if (player.Rating == 0 || opponent.Rating == 0) {
-            QMessageBox::warning(this, "Error", "Failed to fetch player data. Please check the usernames and try again.");
+            post(generation, [this]() {
+                outputLabel->clear();
+                QMessageBox::warning(this, "Error", "Failed to fetch player data. Please check the usernames and try again.");
+            });
             return;
         }
+        showResult(generation, player, opponent, "");
+    }
 
+    void showResult(unsigned generation, const Player& player, const Player& opponent, const std::string& note) {
         Game game(player.Rating, player.RD, opponent.Rating, opponent.RD);
+        game.setKernel(GlickoKernel::Table);
         auto results = game.calculateRatingRes();
 
-        QString resultText = QString("If you win: %1\nIf you lose: %2\nIf you draw: %3")
-                             .arg(std::get<0>(results))
-                             .arg(std::get<1>(results))
-                             .arg(std::get<2>(results));
-        
-        // Analyze risk and provide recommendation
-        std::string riskAnalysis = game.analyzeRisk(player.Rating, opponent.Rating, std::get<0>(results), std::get<1>(results), std::get<2>(results));
-        QString riskAnalysisQString = QString::fromStdString(riskAnalysis);
+        QString resultText = QString("If you win: %1\nIf you lose: %2\nIf you draw: %3\nNew RD: %4")
+                             .arg(results.win)
+                             .arg(results.lose)
+                             .arg(results.draw)
+                             .arg(results.newRD);
 
-        resultText.append("\n\n" + riskAnalysisQString);
+        // Analyze risk and provide recommendation. The surface for this
+        // player is rebuilt in the background; until it is ready the
+        // decision is computed directly.
+        surface.update(player.Rating, player.RD);
+        RiskDecision decision = surface.decide(player.Rating, player.RD, opponent.Rating, opponent.RD, game.abortsUsed());
+        QString riskAnalysisQString = QString::fromStdString(decisionText(decision));
 
-        outputLabel->setText(resultText);
+        resultText.append("\n\n" + riskAnalysisQString);
+        resultText.append(QString::fromStdString(note));
 
+        post(generation, [this, resultText]() { outputLabel->setText(resultText); });
     }
-    void onNewGame() {
-        opponentEdit->clear();
-        outputLabel->clear();
+
+    static std::unique_ptr<StatsCache> openCache() {
+        try {
+            return std::unique_ptr<StatsCache>(new StatsCache(StatsCache::defaultPath()));
+        } catch (const std::exception& ex) {
+            std::cerr << "Error: " << ex.what() << std::endl;
+            return std::unique_ptr<StatsCache>(new StatsCache("")); // this session only
+        }
     }
 
-private:
-    QLineEdit* playerEdit;
-    QLineEdit* opponentEdit;
-    QPushButton* calculateButton;
-    QPushButton* newGameButton;
-    QLabel* outputLabel;
+    // Runs `update` on the GUI thread, unless a newer lookup has started by
+    // the time it gets there.
+    template <class F>
+    void post(unsigned generation, F update) {
+        QMetaObject::invokeMethod(this, [this, generation, update]() {
+            if (worker.isCurrent(generation)) update();
+        }, Qt::QueuedConnection);
+    }
 };
 
 int main(int argc, char* argv[]) {